@@ -0,0 +1,93 @@
+/*
+ * @file   ControllerBench.cpp
+ * @author Armin Zare Zadeh, ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   Microbenchmark of the controller's hot paths: handing a hall
+ *          call over to a running car from 1 to 8 contending network
+ *          threads, and the LOOK scheduling of the queued stops.
+ */
+
+#include <Elevator.h>
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Car and driver shared by the threads of the enqueue benchmark
+static std::shared_ptr<ElevatorCtrl> car;
+static std::unique_ptr<CarDriver> driver;
+
+
+// Hall calls at the car's floor; the driver serves them at the open stop,
+// so the stop table does not grow while the benchmark runs. A producer
+// waits untimed for the driver when the ring is half full, so the drop
+// path is not measured instead of the enqueue.
+static void BM_CallEnqueue(benchmark::State& state) {
+  if (state.thread_index() == 0) {
+    Logger::instance().setLevel(LogLevel::WARN);
+    car = std::make_shared<ElevatorCtrl>();
+    driver.reset(new CarDriver());
+    driver->add(car);
+    driver->make_process_thread();
+  }
+
+  CarCommand command{static_cast<uint16_t>(state.thread_index() + 1), 0, Request::Command::CALL, 0, Request::Direction::UP};
+  for (auto _ : state) {
+    command.msg_id++;
+    car->input_data_consumer(command);
+    if ((command.msg_id & 63) == 0 && car->ingressStats().depth > ElevatorCtrl::INGRESS_CAPACITY / 2) {
+      state.PauseTiming();
+      while (car->ingressStats().depth > 0) std::this_thread::yield();
+      state.ResumeTiming();
+    }
+  }
+
+  if (state.thread_index() == 0) {
+    ElevatorCtrl::IngressStats stats = car->ingressStats();
+    state.counters["dropped"] = benchmark::Counter(static_cast<double>(stats.dropped));
+    state.counters["max_depth"] = benchmark::Counter(static_cast<double>(stats.maxDepth));
+    driver.reset();
+    car.reset();
+  }
+}
+BENCHMARK(BM_CallEnqueue)->ThreadRange(1, 8)->UseRealTime();
+
+
+// Queues the given number of random requests and serves them in a LOOK
+// sweep, as the driver thread does; it took over from preProcessNextQueue
+static void BM_Schedule(benchmark::State& state) {
+  const uint8_t FLOORS = 64;
+  std::mt19937 rng(1);
+  std::vector<Request> requests;
+  for (int64_t i = 0; i < state.range(0); i++) {
+    Request::Command cmd = (rng() % 3 == 0) ? Request::Command::GO : Request::Command::CALL;
+    Request::Direction direction = (rng() % 2 == 0) ? Request::Direction::UP : Request::Direction::DOWN;
+    requests.push_back(Request(1, static_cast<uint16_t>(i), 0, cmd, static_cast<uint8_t>(rng() % FLOORS), direction));
+  }
+
+  StopTable stops;
+  std::vector<Request> served;
+  for (auto _ : state) {
+    for (const auto& r : requests)
+      stops.add(r);
+
+    uint8_t location = 0;
+    Request::Direction direction = Request::Direction::UP;
+    StopTable::Stop stop;
+    while ((stop = stops.next(location, direction)).floor != FloorSet::NONE) {
+      location = static_cast<uint8_t>(stop.floor);
+      direction = stop.direction;
+      served.clear();
+      stops.serve(location, direction, served);
+    }
+    benchmark::DoNotOptimize(served.data());
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_Schedule)->RangeMultiplier(8)->Range(8, 4096);
+
+
+BENCHMARK_MAIN();
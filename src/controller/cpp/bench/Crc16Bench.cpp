@@ -0,0 +1,61 @@
+/*
+ * @file   Crc16Bench.cpp
+ * @author Armin Zare Zadeh, ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   Microbenchmark of the CRC16 engine against the former bit
+ *          by bit implementation, on protocol frames and large blocks.
+ */
+
+#include <NetProtocol.h>
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+using namespace Net;
+
+// Former bit by bit CRC (without its per-byte logging)
+static uint16_t crc16Bitwise(const uint8_t* data, size_t len) {
+  uint16_t crc = 0xFFFF;
+  for (size_t n = 0; n < len; n++) {
+    uint8_t cur_byte = data[n];
+    for (int i = 0; i < 8; i++) {
+      if ((crc & 0x0001) ^ (cur_byte & 0x0001))
+        crc = (crc >> 1) ^ POLY;
+      else
+        crc >>= 1;
+      cur_byte >>= 1;
+    }
+  }
+  crc = (~crc & 0xFFFF);
+  crc = (crc << 8) | ((crc >> 8) & 0xFF);
+  return crc & 0xFFFF;
+}
+
+
+// The frame sizes are a request frame without its CRC and a large block
+static void BM_Crc16Bitwise(benchmark::State& state) {
+  std::vector<uint8_t> block(static_cast<size_t>(state.range(0)));
+  for (size_t i = 0; i < block.size(); i++) block[i] = static_cast<uint8_t>(i * 31 + 7);
+  for (auto _ : state) {
+    block[0]++;
+    benchmark::DoNotOptimize(crc16Bitwise(block.data(), block.size()));
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_Crc16Bitwise)->Arg(MsgProtocol::HDR_LEN + MsgProtocol::PAYLOAD_LEN)->Arg(4096);
+
+
+static void BM_Crc16(benchmark::State& state) {
+  std::vector<uint8_t> block(static_cast<size_t>(state.range(0)));
+  for (size_t i = 0; i < block.size(); i++) block[i] = static_cast<uint8_t>(i * 31 + 7);
+  for (auto _ : state) {
+    block[0]++;
+    benchmark::DoNotOptimize(crc16(block.data(), block.size()));
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_Crc16)->Arg(MsgProtocol::HDR_LEN + MsgProtocol::PAYLOAD_LEN)->Arg(4096);
+
+
+BENCHMARK_MAIN();
@@ -0,0 +1,89 @@
+/*
+ * @file   LoggerBench.cpp
+ * @author Armin Zare Zadeh, ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   Microbenchmark of the logging cost per request: the former
+ *          std::cout dumps, which are kept here as the reference, against
+ *          the asynchronous logger. The log goes to stdout, e.g. run it with
+ *          --benchmark_out=FILE and stdout redirected to /dev/null or to a
+ *          terminal.
+ */
+
+#include <NetProtocol.h>
+#include <benchmark/benchmark.h>
+
+#include <iostream>
+
+using namespace Net;
+
+// Former logging of one request frame: hex dump, header, payload and the
+// decoded request, every line flushed with std::endl
+static void streamLog(const uint8_t* packet, size_t len, const MsgProtocol::msg_hdr_t& header, const MsgProtocol::msg_payload_t& payload) {
+  for (size_t i = 0; i < len; i++)
+    std::cout << std::hex << (packet[i] & 0xFF) << " " << std::dec;
+  std::cout << std::endl;
+  std::cout << "msg header(size:" << sizeof(MsgProtocol::msg_hdr_t)<< "):" << std::endl;
+  std::cout << "  magic:" << std::hex << (header.magic & 0xFF) << std::endl;
+  std::cout << "  tx node addr:" << std::hex << (header.tx_node_addr & 0xFFFF) << std::endl;
+  std::cout << "  rx node addr:" << std::hex << (header.rx_node_addr & 0xFFFF) << std::endl;
+  std::cout << "  msg class:" << std::hex << (header.msg_class & 0xFF) << std::endl;
+  std::cout << "  msg id:" << std::hex << (header.msg_id & 0xFFFF) << std::endl;
+  std::cout << "  len:" << std::hex << (header.len & 0xFFFF) << std::endl;
+  std::cout << "msg payload:" << std::endl;
+  std::cout << "  timetag:" << std::hex << (payload.timetag & 0xFFFFFFFFFFFFFFFF) << std::endl;
+  std::cout << "  command:" << std::hex << (payload.command & 0xFF) << std::endl;
+  std::cout << "  floor number:" << std::hex << (payload.floor_num & 0xFF) << std::endl;
+  std::cout << "  direction:" << std::hex << (payload.direction & 0xFF) << std::endl;
+  std::cout << "NetProtocol: (" << std::hex << header.tx_node_addr << "," << header.msg_id << "," << (payload.command&0xFF) << "," << (payload.floor_num&0xFF) << "," << (payload.direction&0xFF) << ")" << std::dec << std::endl;
+}
+
+
+// Current logging of one request frame
+static void asyncLog(const uint8_t* packet, size_t len, const MsgProtocol::msg_hdr_t& header, const MsgProtocol::msg_payload_t& payload) {
+  LOG_DEBUG("frame: {}", Logger::bytes(packet, len));
+  MsgProtocol::print_header(header);
+  MsgProtocol::print_payload(payload);
+  LOG_DEBUG("NetProtocol: ({},{},{},{},{})", Logger::hex(header.tx_node_addr), Logger::hex(header.msg_id), payload.command, payload.floor_num, payload.direction);
+}
+
+
+// Logs the requests in batches which fit into the logger's ring; only the
+// time spent in the log calls is counted
+template <typename F>
+static void logLoop(benchmark::State& state, F log) {
+  const size_t BATCH = 200;
+  MsgProtocol::msg_hdr_t header{MsgProtocol::MagicValue, NODE_ADDRESS, 1, 0x02, 0, MsgProtocol::DATA_FRAME_LEN};
+  MsgProtocol::msg_payload_t payload{0xa, 1, 5, 1};
+  uint8_t packet[MsgProtocol::DATA_FRAME_LEN];
+  MsgProtocol::encode_data_frame(packet, header, payload);
+
+  uint64_t dropped = Logger::instance().dropped();
+  size_t i = 0;
+  for (auto _ : state) {
+    header.msg_id++;
+    log(packet, sizeof(packet), header, payload);
+    if (++i % BATCH == 0) {
+      state.PauseTiming();
+      Logger::instance().flush();
+      state.ResumeTiming();
+    }
+  }
+  Logger::instance().flush();
+  state.counters["dropped"] = benchmark::Counter(static_cast<double>(Logger::instance().dropped() - dropped));
+}
+
+
+static void BM_StreamLog(benchmark::State& state) {
+  logLoop(state, streamLog);
+}
+BENCHMARK(BM_StreamLog);
+
+
+static void BM_AsyncLog(benchmark::State& state) {
+  logLoop(state, asyncLog);
+}
+BENCHMARK(BM_AsyncLog);
+
+
+BENCHMARK_MAIN();
@@ -0,0 +1,90 @@
+/*
+ * @file   MessagePathBench.cpp
+ * @author Armin Zare Zadeh, ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   Microbenchmark of the hand-over of a decoded request from the
+ *          network protocol handler to the controller: the former tuple
+ *          plumbing, which is kept here as the reference, against the
+ *          typed CarCommand message.
+ */
+
+#include <Message.h>
+#include <signal_slot.h>
+#include <benchmark/benchmark.h>
+
+#include <tuple>
+
+using CommandTuple = std::tuple<uint16_t, uint16_t, uint8_t, uint8_t, uint8_t>;
+
+
+// Former path: the request is copied into a shared tuple member, emitted by
+// reference and unpacked again with std::tie by the controller
+struct LegacyPath {
+  signal_slot<CommandTuple&> onNewData;
+  CommandTuple output_items = std::make_tuple(0, 0, 0, 0, 0);
+  uint64_t sum = 0;
+
+  void input_data_consumer(CommandTuple& cmd_tuple) {
+    uint8_t cmd, floor_num, direction;
+    uint16_t node_addr, msg_id;
+    std::tie(node_addr, msg_id, cmd, floor_num, direction) = cmd_tuple;
+    Request request(node_addr, msg_id, 0, static_cast<Request::Command>(cmd), floor_num, static_cast<Request::Direction>(direction));
+    sum += request.floor_ + request.msg_id_;
+  }
+
+  void handle(const Request& request) {
+    output_items = std::make_tuple(request.node_addr_, request.msg_id_,
+                                   static_cast<uint8_t>(request.cmd_), request.floor_,
+                                   static_cast<uint8_t>(request.direction_));
+    onNewData.emit(output_items);
+  }
+};
+
+
+// Current path: the decoded command is emitted from the stack
+struct TypedPath {
+  signal_slot<const CarCommand&> onNewData;
+  uint64_t sum = 0;
+
+  void input_data_consumer(const CarCommand& command) {
+    Request request(command.node_addr, command.msg_id, 0, command.cmd, command.floor, command.direction);
+    sum += request.floor_ + request.msg_id_;
+  }
+
+  void handle(const CarCommand& command) {
+    onNewData.emit(command);
+  }
+};
+
+
+static void BM_TuplePlumbing(benchmark::State& state) {
+  LegacyPath legacy;
+  legacy.onNewData.connect_member(&legacy, &LegacyPath::input_data_consumer);
+  uint16_t i = 0;
+  for (auto _ : state) {
+    ++i;
+    // the former parser built a Request from the decoded frame first
+    Request request(1, i, 0xa, Request::Command::CALL, static_cast<uint8_t>(i & 15), Request::Direction::UP);
+    legacy.handle(request);
+  }
+  benchmark::DoNotOptimize(legacy.sum);
+}
+BENCHMARK(BM_TuplePlumbing);
+
+
+static void BM_TypedMessage(benchmark::State& state) {
+  TypedPath typed;
+  typed.onNewData.connect_member(&typed, &TypedPath::input_data_consumer);
+  uint16_t i = 0;
+  for (auto _ : state) {
+    ++i;
+    CarCommand command{1, i, Request::Command::CALL, static_cast<uint8_t>(i & 15), Request::Direction::UP};
+    typed.handle(command);
+  }
+  benchmark::DoNotOptimize(typed.sum);
+}
+BENCHMARK(BM_TypedMessage);
+
+
+BENCHMARK_MAIN();
@@ -0,0 +1,168 @@
+/*
+ * @file   MsgProtocolBench.cpp
+ * @author Armin Zare Zadeh, ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   Microbenchmark of the message encoding and decoding, and of
+ *          the request and status paths of the protocol handler. The
+ *          former stream based serialization is kept here as the
+ *          reference to compare against.
+ */
+
+#include <NetProtocol.h>
+#include <benchmark/benchmark.h>
+
+#include <sstream>
+
+using namespace Net;
+
+// Former encoding of a status frame: serialized through an ostringstream,
+// copied into a vector for the CRC, serialized again and copied once more
+static std::vector<uint8_t> streamEncode(MsgProtocol::msg_hdr_t header, MsgProtocol::msg_payload_t payload) {
+  header.tx_node_addr = htons(header.tx_node_addr);
+  header.rx_node_addr = htons(header.rx_node_addr);
+  header.msg_id = htons(header.msg_id);
+  header.len = htons(header.len);
+  uint64_t timetag = MsgProtocol::load64(reinterpret_cast<const uint8_t*>(&payload.timetag));
+
+  std::ostringstream ostream(std::ostringstream::ate);
+  ostream.write((char*)&header, sizeof(header));
+  ostream.write((char*)&timetag, sizeof(timetag));
+  ostream.write((char*)&payload.command, 3);
+
+  std::vector<uint8_t> buffer;
+  const std::string& str = ostream.str();
+  buffer.insert(buffer.end(), str.begin(), str.end());
+  uint16_t crc = htons(crc16(buffer));
+  ostream.write((char*)&crc, sizeof(crc));
+
+  std::vector<uint8_t> frame;
+  const std::string& out = ostream.str();
+  frame.insert(frame.end(), out.begin(), out.end());
+  return frame;
+}
+
+
+// Former decoding of a request frame through an istringstream
+static MsgProtocol::msg_payload_t streamDecode(const std::vector<uint8_t>& packet, MsgProtocol::msg_hdr_t& header) {
+  std::istringstream stream(std::string((char*)&packet[0], packet.size()));
+  stream.read((char*)&header, sizeof(header));
+  header.tx_node_addr = ntohs(header.tx_node_addr);
+  header.rx_node_addr = ntohs(header.rx_node_addr);
+  header.msg_id = ntohs(header.msg_id);
+  header.len = ntohs(header.len);
+
+  MsgProtocol::msg_payload_t payload;
+  uint8_t timetag[8];
+  stream.read((char*)timetag, sizeof(timetag));
+  payload.timetag = MsgProtocol::load64(timetag);
+  stream.read((char*)&payload.command, 3);
+  return payload;
+}
+
+
+// Request frame of the benchmarks
+static MsgProtocol::msg_hdr_t requestHeader() {
+  return MsgProtocol::msg_hdr_t{MsgProtocol::MagicValue, 1, NODE_ADDRESS, 0x02, 0, MsgProtocol::DATA_FRAME_LEN};
+}
+
+static MsgProtocol::msg_payload_t requestPayload() {
+  return MsgProtocol::msg_payload_t{0xa, 1, 5, 1};
+}
+
+
+static void BM_EncodeStream(benchmark::State& state) {
+  MsgProtocol::msg_hdr_t header = requestHeader();
+  for (auto _ : state) {
+    header.msg_id++;
+    benchmark::DoNotOptimize(streamEncode(header, requestPayload()));
+  }
+}
+BENCHMARK(BM_EncodeStream);
+
+
+static void BM_EncodeDataFrame(benchmark::State& state) {
+  MsgProtocol::msg_hdr_t header = requestHeader();
+  uint8_t buffer[MsgProtocol::DATA_FRAME_LEN];
+  for (auto _ : state) {
+    header.msg_id++;
+    MsgProtocol::encode_data_frame(buffer, header, requestPayload());
+    benchmark::DoNotOptimize(buffer);
+  }
+}
+BENCHMARK(BM_EncodeDataFrame);
+
+
+static void BM_DecodeStream(benchmark::State& state) {
+  std::vector<uint8_t> packet = streamEncode(requestHeader(), requestPayload());
+  for (auto _ : state) {
+    MsgProtocol::msg_hdr_t header;
+    benchmark::DoNotOptimize(streamDecode(packet, header));
+    benchmark::DoNotOptimize(header);
+  }
+}
+BENCHMARK(BM_DecodeStream);
+
+
+static void BM_DecodeDataFrame(benchmark::State& state) {
+  uint8_t packet[MsgProtocol::DATA_FRAME_LEN];
+  MsgProtocol::encode_data_frame(packet, requestHeader(), requestPayload());
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(MsgProtocol::decode_header(packet));
+    benchmark::DoNotOptimize(MsgProtocol::decode_payload(packet + MsgProtocol::HDR_LEN));
+  }
+}
+BENCHMARK(BM_DecodeDataFrame);
+
+
+static void BM_EncodeHeader(benchmark::State& state) {
+  MsgProtocol::msg_hdr_t header = requestHeader();
+  uint8_t buffer[MsgProtocol::HDR_LEN];
+  for (auto _ : state) {
+    header.msg_id++;
+    MsgProtocol::encode_header(buffer, header);
+    benchmark::DoNotOptimize(buffer);
+  }
+}
+BENCHMARK(BM_EncodeHeader);
+
+
+static void BM_DecodeHeader(benchmark::State& state) {
+  uint8_t buffer[MsgProtocol::HDR_LEN];
+  MsgProtocol::encode_header(buffer, requestHeader());
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(MsgProtocol::decode_header(buffer));
+  }
+}
+BENCHMARK(BM_DecodeHeader);
+
+
+// Checks, acknowledges and decodes a request frame. Without a client socket
+// the reply is encoded but not queued; the frame dumps are left out.
+static void BM_Handle(benchmark::State& state) {
+  Logger::instance().setLevel(LogLevel::INFO);
+  uint8_t packet[MsgProtocol::DATA_FRAME_LEN];
+  MsgProtocol::encode_data_frame(packet, requestHeader(), requestPayload());
+  std::weak_ptr<TransportSocket::ClientSocket> socket;
+  CarCommand command;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(MsgProtocol::handle(socket, packet, sizeof(packet), 1, command));
+    benchmark::DoNotOptimize(command);
+  }
+}
+BENCHMARK(BM_Handle);
+
+
+// Encodes a status report; without a client socket it is not queued
+static void BM_Xmit(benchmark::State& state) {
+  std::weak_ptr<TransportSocket::ClientSocket> socket;
+  CarStatus status{1, 0, 0, 5, CarState::STOPPED, Request::Direction::UP};
+  for (auto _ : state) {
+    status.msg_id++;
+    MsgProtocol::xmit(socket, status);
+  }
+}
+BENCHMARK(BM_Xmit);
+
+
+BENCHMARK_MAIN();
@@ -0,0 +1,121 @@
+/*
+ * @file   SignalSlotBench.cpp
+ * @author Armin Zare Zadeh, ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   Microbenchmark of the signal/slot emit path with 1 to 16 slots
+ *          against the former std::map based signal, which is kept here as
+ *          the reference. Heap allocations are counted per emit as well.
+ */
+
+#include <signal_slot.h>
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <map>
+#include <new>
+#include <tuple>
+
+static std::atomic<uint64_t> allocations(0);
+
+// GCC cannot tell that the replaced operators below pair up once inlined
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(size)) return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+
+// Former signal: the slots are copied out of the map on every emit
+template <typename... Args>
+class legacy_signal_slot {
+ public:
+  int connect(std::function<void(Args...)> const& slot) const {
+    slots_.insert(std::make_pair(++current_id_, slot));
+    return current_id_;
+  }
+
+  void emit(Args... p) {
+    for(auto it : slots_) {
+      it.second(p...);
+    }
+  }
+
+ private:
+  mutable std::map<int, std::function<void(Args...)>> slots_;
+  mutable int current_id_ = 0;
+};
+
+
+using StatusTuple = std::tuple<uint16_t, uint16_t, uint8_t, uint8_t, uint8_t>;
+
+// Slot capturing a shared pointer, as connect_member() does
+struct Receiver {
+  uint64_t sum = 0;
+  void consume(StatusTuple& t) { sum += std::get<0>(t) + std::get<3>(t); }
+};
+
+
+// Reports the heap allocations per emit next to the time
+template <typename F>
+static void emitLoop(benchmark::State& state, StatusTuple& status, F emit) {
+  uint64_t before = allocations.load();
+  for (auto _ : state) {
+    std::get<0>(status)++;
+    emit(status);
+  }
+  state.counters["allocs_per_emit"] = benchmark::Counter(static_cast<double>(allocations.load() - before) / state.iterations());
+}
+
+
+static void BM_LegacyEmit(benchmark::State& state) {
+  auto receiver = std::make_shared<Receiver>();
+  StatusTuple status(1, 2, 3, 4, 5);
+  legacy_signal_slot<StatusTuple&> legacy;
+  for (int64_t n = 0; n < state.range(0); n++)
+    legacy.connect([receiver](StatusTuple& t) { receiver->consume(t); });
+  emitLoop(state, status, [&](StatusTuple& t) { legacy.emit(t); });
+  benchmark::DoNotOptimize(receiver->sum);
+}
+BENCHMARK(BM_LegacyEmit)->RangeMultiplier(2)->Range(1, 16);
+
+
+static void BM_Emit(benchmark::State& state) {
+  auto receiver = std::make_shared<Receiver>();
+  StatusTuple status(1, 2, 3, 4, 5);
+  signal_slot<StatusTuple&> current;
+  for (int64_t n = 0; n < state.range(0); n++)
+    current.connect_member<Receiver>(receiver, &Receiver::consume);
+  emitLoop(state, status, [&](StatusTuple& t) { current.emit(t); });
+  benchmark::DoNotOptimize(receiver->sum);
+}
+BENCHMARK(BM_Emit)->RangeMultiplier(2)->Range(1, 16);
+
+
+// Queued connection: post to the mailbox and dispatch in batches
+static void BM_QueuedEmit(benchmark::State& state) {
+  auto receiver = std::make_shared<Receiver>();
+  StatusTuple status(1, 2, 3, 4, 5);
+  signal_slot<StatusTuple&> queued;
+  auto mailbox = std::make_shared<signal_mailbox<StatusTuple&>>(1024);
+  queued.connect_queued(mailbox, [receiver](StatusTuple& t) { receiver->consume(t); });
+  size_t i = 0;
+  emitLoop(state, status, [&](StatusTuple& t) {
+    queued.emit(t);
+    if ((++i & 255) == 0) mailbox->dispatch();
+  });
+  mailbox->dispatch();
+  benchmark::DoNotOptimize(receiver->sum);
+}
+BENCHMARK(BM_QueuedEmit);
+
+
+BENCHMARK_MAIN();
@@ -0,0 +1,41 @@
+/*
+ * @file   TraceBench.cpp
+ * @author Armin Zare Zadeh, ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   Microbenchmark of the cost of one trace event, with tracing
+ *          switched off and with tracing into a memory-mapped file.
+ */
+
+#include <Trace.h>
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <string>
+
+static void traceLoop(benchmark::State& state) {
+  uint16_t i = 0;
+  for (auto _ : state) {
+    ++i;
+    Tracer::event(TraceEvent::Type::FLOOR, 0, 0, i, static_cast<uint8_t>(i), 1);
+  }
+}
+
+
+static void BM_TracingOff(benchmark::State& state) {
+  traceLoop(state);
+}
+BENCHMARK(BM_TracingOff);
+
+
+static void BM_TracingOn(benchmark::State& state) {
+  std::string path = "/tmp/TraceBench.trace";
+  Tracer::instance().open(path);
+  traceLoop(state);
+  Tracer::instance().close();
+  std::remove(path.c_str());
+}
+BENCHMARK(BM_TracingOn);
+
+
+BENCHMARK_MAIN();
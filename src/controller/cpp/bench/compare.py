@@ -0,0 +1,59 @@
+'''
+ * @file   compare.py
+ * @author Armin Zare Zadeh, ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   Compares two JSON result files of the benchmarks, e.g. of two
+ *          commits, and fails if a benchmark got slower than the threshold.
+ *            compare.py [--threshold PERCENT] baseline.json contender.json
+'''
+#!/usr/bin/env python3
+
+import argparse
+import json
+import sys
+
+
+def load(fileName):
+  '''
+  Returns the time per iteration of every benchmark in the result file in
+  nanoseconds. Only the mean is taken when the benchmarks were repeated.
+  '''
+  units = {'ns': 1.0, 'us': 1e3, 'ms': 1e6, 's': 1e9}
+  with open(fileName) as f:
+    results = json.load(f)
+  times = {}
+  for b in results['benchmarks']:
+    repeated = b.get('repetitions', 1) > 1
+    if repeated != (b.get('run_type') == 'aggregate') or b.get('aggregate_name', 'mean') != 'mean':
+      continue
+    times[b.get('run_name', b['name'])] = b['real_time'] * units[b.get('time_unit', 'ns')]
+  return times
+
+
+def main():
+  parser = argparse.ArgumentParser(description='Compare two benchmark result files.')
+  parser.add_argument('--threshold', type=float, default=10.0, help='allowed slowdown in percent')
+  parser.add_argument('baseline')
+  parser.add_argument('contender')
+  args = parser.parse_args()
+
+  baseline = load(args.baseline)
+  contender = load(args.contender)
+
+  regressions = 0
+  print('{:<48} {:>12} {:>12} {:>8}'.format('benchmark', 'base (ns)', 'new (ns)', 'change'))
+  for name, before in baseline.items():
+    if name not in contender:
+      continue
+    after = contender[name]
+    change = (after - before) / before * 100.0 if before > 0 else 0.0
+    slower = change > args.threshold
+    regressions += slower
+    print('{:<48} {:>12.1f} {:>12.1f} {:>+7.1f}%{}'.format(name, before, after, change, '  SLOWER' if slower else ''))
+
+  return 1 if regressions > 0 else 0
+
+
+if __name__ == '__main__':
+  sys.exit(main())
@@ -0,0 +1,81 @@
+/*
+ * @file   ByteRing.h
+ * @author Armin Zare Zadeh, ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   Fixed size byte ring buffer. It is being used as the receive
+ *          buffer of a client connection, where incoming bytes are kept
+ *          until they add up to complete protocol frames.
+ */
+
+#ifndef D_BYTE_RING_H
+#define D_BYTE_RING_H
+
+#include "NonCopyable.h"
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <cstring>
+#include <cstdint>
+
+
+
+// Byte ring with free running head and tail positions. Bytes are received
+// straight into the contiguous free region at the tail and consumed from the
+// head, so buffered bytes are never moved. A ring is used by one thread at a
+// time and is not thread-safe.
+class ByteRing : noncopyable {
+private:
+  std::unique_ptr<uint8_t[]> data_;
+  const size_t mask_;
+  size_t head_;
+  size_t tail_;
+
+public:
+  // ctor; the capacity must be a power of two
+  explicit ByteRing(size_t capacity) : data_(new uint8_t[capacity]), mask_(capacity - 1), head_(0), tail_(0) {
+    if (capacity < 2 || (capacity & (capacity - 1)) != 0)
+      throw std::invalid_argument("Ring capacity is not a power of two: " + std::to_string(capacity));
+  }
+
+  size_t capacity() const { return mask_ + 1; }
+
+  // Number of buffered bytes
+  size_t size() const { return tail_ - head_; }
+  bool empty() const { return tail_ == head_; }
+  bool full() const { return size() == capacity(); }
+
+  // Contiguous free region at the tail; its length is returned in len. The
+  // bytes written into it are appended by commit().
+  uint8_t* writePtr(size_t& len) {
+    size_t pos = tail_ & mask_;
+    len = std::min(capacity() - size(), capacity() - pos);
+    return &data_[pos];
+  }
+
+  void commit(size_t len) { tail_ += len; }
+
+  // Buffered byte at the given offset from the head
+  uint8_t at(size_t offset) const { return data_[(head_ + offset) & mask_]; }
+
+  // Copies len buffered bytes starting at the given offset from the head
+  void copyOut(size_t offset, uint8_t* dst, size_t len) const {
+    size_t pos = (head_ + offset) & mask_;
+    size_t first = std::min(len, capacity() - pos);
+    memcpy(dst, &data_[pos], first);
+    memcpy(dst + first, &data_[0], len - first);
+  }
+
+  // Drops len bytes from the head
+  void consume(size_t len) {
+    head_ += len;
+    // Rewind an empty ring, so that the next receive gets the whole buffer
+    // as one contiguous region
+    if (head_ == tail_) head_ = tail_ = 0;
+  }
+};
+
+
+#endif /* D_BYTE_RING_H */
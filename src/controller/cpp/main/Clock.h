@@ -0,0 +1,300 @@
+/*
+ * @file   Clock.h
+ * @author Armin Zare Zadeh, ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   Time source abstraction for the elevator controller.
+ *          The system clock follows the wall time, while the virtual
+ *          clock implements a discrete-event simulation time base
+ *          which lets the controller replay long traffic scenarios
+ *          in a fraction of the wall time.
+ */
+
+#ifndef D_CLOCK_H
+#define D_CLOCK_H
+
+#include "NonCopyable.h"
+
+#include <vector>
+#include <queue>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <limits>
+
+
+
+// Return the number of milliseconds since the steady clock epoch. NOTE: The
+// returned timestamp may be used for accurately measuring intervals but has
+// no relation to wall clock time. It must not be used for synchronization
+// across multiple nodes.
+//
+// \return The number of milliseconds since the steady clock epoch.
+inline int64_t current_time_ms() {
+  std::chrono::milliseconds ms_since_epoch =
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now().time_since_epoch());
+  return ms_since_epoch.count();
+}
+
+
+// Interface of a time source. Every timestamp and every timed wait of the
+// controller goes through this interface, so the same controller code runs
+// either in real time or in simulated time.
+class Clock : noncopyable {
+public:
+  static const int64_t NO_DEADLINE = std::numeric_limits<int64_t>::max();
+
+  virtual ~Clock() {}
+
+  // Current time in milliseconds
+  virtual int64_t now_ms() = 0;
+
+  // Blocks the calling thread until the given time
+  virtual void sleep_until_ms(int64_t time_ms) = 0;
+
+  // Waits on the condition variable until the predicate holds or the
+  // deadline has passed; NO_DEADLINE waits until notified. Returns the final
+  // value of the predicate.
+  virtual bool wait_until_ms(std::unique_lock<std::mutex>& lock,
+                             std::condition_variable& cv,
+                             int64_t deadline_ms,
+                             const std::function<bool ()>& pred) = 0;
+
+  // Wakes up one thread waiting on the condition variable
+  virtual void notify_one(std::condition_variable& cv) = 0;
+
+  // Called by each thread driven by this clock when it starts and exits
+  virtual void attach() {}
+  virtual void detach() {}
+};
+
+
+// Wall time clock based on std::chrono::steady_clock
+class SystemClock : public Clock {
+public:
+  int64_t now_ms() {
+    return current_time_ms();
+  }
+
+  void sleep_until_ms(int64_t time_ms) {
+    std::this_thread::sleep_until(to_time_point(time_ms));
+  }
+
+  bool wait_until_ms(std::unique_lock<std::mutex>& lock,
+                     std::condition_variable& cv,
+                     int64_t deadline_ms,
+                     const std::function<bool ()>& pred) {
+    // NO_DEADLINE would overflow the conversion to nanoseconds
+    if (deadline_ms == NO_DEADLINE) {
+      cv.wait(lock, pred);
+      return true;
+    }
+    return cv.wait_until(lock, to_time_point(deadline_ms), pred);
+  }
+
+  void notify_one(std::condition_variable& cv) {
+    cv.notify_one();
+  }
+
+  // Shared instance used by default by all controllers
+  static std::shared_ptr<Clock> instance() {
+    static std::shared_ptr<Clock> clock = std::make_shared<SystemClock>();
+    return clock;
+  }
+
+private:
+  static std::chrono::steady_clock::time_point to_time_point(int64_t time_ms) {
+    return std::chrono::steady_clock::time_point(std::chrono::milliseconds(time_ms));
+  }
+};
+
+
+// Discrete-event simulation clock. The threads driven by this clock
+// (participants) hand a single execution token around: exactly one
+// participant or the scheduler runs at any time. A participant which sleeps
+// or waits posts a wake-up event into the event queue and yields the token.
+// The scheduler then jumps the virtual time to the earliest pending event and
+// resumes its owner, or runs the callback scheduled for that time. Events
+// with the same time stamp are dispatched in the order they were posted,
+// which makes every replay of a scenario take the same decisions.
+class VirtualClock : public Clock {
+private:
+  // Book keeping of a thread driven by this clock
+  struct Participant {
+    std::thread::id id;
+    std::condition_variable cv;
+    bool hasToken = false;
+    uint64_t gen = 0;                       // invalidates outdated wake-up events
+    std::condition_variable* waitingOn = nullptr;
+  };
+
+  // Entry of the event queue: either the wake-up of a participant or a
+  // callback which is run on the scheduler thread
+  struct Event {
+    int64_t time;
+    uint64_t seq;
+    Participant* participant;
+    uint64_t gen;
+    std::function<void ()> fn;
+  };
+
+  struct EventLater {
+    bool operator()(const Event& a, const Event& b) const {
+      return (a.time != b.time) ? a.time > b.time : a.seq > b.seq;
+    }
+  };
+
+  std::mutex mutex_;
+  std::condition_variable schedulerCv_;
+  std::priority_queue<Event, std::vector<Event>, EventLater> events_;
+  std::vector<std::unique_ptr<Participant>> participants_;
+  int64_t now_;
+  uint64_t seq_;
+  bool running_;   // a participant holds the execution token
+  bool shutdown_;  // participants are released and run freely
+
+public:
+  // ctor
+  VirtualClock(int64_t start_ms = 0) : now_(start_ms), seq_(0), running_(false), shutdown_(false) {}
+
+  int64_t now_ms() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return now_;
+  }
+
+  void sleep_until_ms(int64_t time_ms) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    Participant* p = self();
+    if (shutdown_ || p == nullptr) return;
+    post(time_ms, p);
+    park(lock, p);
+  }
+
+  bool wait_until_ms(std::unique_lock<std::mutex>& userLock,
+                     std::condition_variable& cv,
+                     int64_t deadline_ms,
+                     const std::function<bool ()>& pred) {
+    while (!pred()) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      Participant* p = self();
+      if (shutdown_ || p == nullptr || now_ >= deadline_ms) return pred();
+      p->waitingOn = &cv;
+      if (deadline_ms != NO_DEADLINE) post(deadline_ms, p);
+      userLock.unlock();
+      park(lock, p);
+      p->waitingOn = nullptr;
+      lock.unlock();
+      userLock.lock();
+    }
+    return true;
+  }
+
+  void notify_one(std::condition_variable& cv) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& p : participants_) {
+      if (p->waitingOn == &cv) {
+        p->waitingOn = nullptr;
+        post(now_, p.get());
+        return;
+      }
+    }
+  }
+
+  // Registers the calling thread and blocks until it gets the token
+  void attach() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (shutdown_) return;
+    participants_.push_back(std::unique_ptr<Participant>(new Participant()));
+    Participant* p = participants_.back().get();
+    p->id = std::this_thread::get_id();
+    post(now_, p);
+    schedulerCv_.notify_all();
+    park(lock, p);
+  }
+
+  // Unregisters the calling thread and gives the token back
+  void detach() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = std::find_if(participants_.begin(), participants_.end(),
+                           [] (const std::unique_ptr<Participant>& p) { return p->id == std::this_thread::get_id(); });
+    if (it == participants_.end()) return;
+    if ((*it)->hasToken) running_ = false;
+    participants_.erase(it);
+    schedulerCv_.notify_all();
+  }
+
+  // Blocks until the given number of participants has attached
+  void wait_attached(size_t num) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    schedulerCv_.wait(lock, [&]() -> bool { return participants_.size() >= num; });
+  }
+
+  // Schedules a callback which is run on the scheduler thread at the given time
+  void schedule(int64_t time_ms, std::function<void ()> fn) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    events_.push(Event{std::max(time_ms, now_), seq_++, nullptr, 0, std::move(fn)});
+  }
+
+  // Scheduler loop: dispatches all events up to the given time and leaves
+  // the virtual time at that point
+  void run_until(int64_t end_ms) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      schedulerCv_.wait(lock, [&]() -> bool { return !running_; });
+      if (events_.empty() || events_.top().time > end_ms) break;
+
+      Event ev = events_.top();
+      events_.pop();
+      if (ev.participant != nullptr && ev.gen != ev.participant->gen) continue; // outdated wake-up
+
+      now_ = std::max(now_, ev.time);
+      if (ev.participant != nullptr) {
+        ev.participant->hasToken = true;
+        running_ = true;
+        ev.participant->cv.notify_one();
+      } else {
+        lock.unlock();
+        ev.fn();
+        lock.lock();
+      }
+    }
+    now_ = std::max(now_, end_ms);
+  }
+
+  // Releases all participants. From now on sleeps and waits return at once,
+  // so that the participant threads can notice a stop request and exit.
+  void shutdown() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutdown_ = true;
+    running_ = false;
+    for (auto& p : participants_) p->cv.notify_all();
+  }
+
+private:
+  Participant* self() {
+    for (auto& p : participants_)
+      if (p->id == std::this_thread::get_id()) return p.get();
+    return nullptr;
+  }
+
+  // Posts a wake-up event for the participant; earlier ones become outdated
+  void post(int64_t time_ms, Participant* p) {
+    events_.push(Event{std::max(time_ms, now_), seq_++, p, ++p->gen, nullptr});
+  }
+
+  // Yields the token to the scheduler and waits until it comes back
+  void park(std::unique_lock<std::mutex>& lock, Participant* p) {
+    p->hasToken = false;
+    running_ = false;
+    schedulerCv_.notify_all();
+    p->cv.wait(lock, [&]() -> bool { return p->hasToken || shutdown_; });
+  }
+};
+
+
+#endif /* D_CLOCK_H */
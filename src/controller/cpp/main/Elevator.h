@@ -15,6 +15,17 @@
 #include "StoppableTask.h"
 #include "signal_slot.h"
 #include "NetProtocol.h"
+#include "Clock.h"
+#include "StopTable.h"
+#include "MpscRing.h"
+#include "TimerWheel.h"
+#include "SeqLock.h"
+#include "Message.h"
+#include "Logger.h"
+#include "LatencyHistogram.h"
+#include "Metrics.h"
+#include "MetricsExporter.h"
+#include "Trace.h"
 
 #include <deque>
 #include <queue>
@@ -29,6 +40,8 @@
 #include <functional>
 #include <stack>
 #include <limits>
+#include <climits>
+#include <atomic>
 #include <thread>
 #include <future>
 #include <sstream>
@@ -40,20 +53,6 @@
 
 
 
-// Return the number of milliseconds since the steady clock epoch. NOTE: The
-// returned timestamp may be used for accurately measuring intervals but has
-// no relation to wall clock time. It must not be used for synchronization
-// across multiple nodes.
-//
-// \return The number of milliseconds since the steady clock epoch.
-inline int64_t current_time_ms() {
-  std::chrono::milliseconds ms_since_epoch =
-      std::chrono::duration_cast<std::chrono::milliseconds>(
-          std::chrono::steady_clock::now().time_since_epoch());
-  return ms_since_epoch.count();
-}
-
-
 // RAII method to safely join the thread
 class ThreadJoiner {
   std::thread& m_th;
@@ -67,84 +66,279 @@ public:
 };
 
 
+// Wake-up primitive of a driver thread. The mutex is only taken by the
+// notifying side when the driver is actually parked, so posting new work to
+// a busy driver stays lock-free.
+class Wakeup : noncopyable {
+private:
+  std::shared_ptr<Clock> clock_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::atomic<bool> sleeping_;
+
+public:
+  // ctor
+  Wakeup(std::shared_ptr<Clock> clock) : clock_(clock), sleeping_(false) {}
+
+  // Wakes up the driver if it is parked. The caller must have published its
+  // work before.
+  void notify() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping_.load(std::memory_order_relaxed)) {
+      { std::lock_guard<std::mutex> locker(mutex_); }
+      clock_->notify_one(cv_);
+    }
+  }
+
+  // Parks the driver until the predicate holds or the deadline has passed
+  void wait_until_ms(int64_t deadline_ms, const std::function<bool ()>& pred) {
+    std::unique_lock<std::mutex> locker(mutex_);
+    sleeping_.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    clock_->wait_until_ms(locker, cv_, deadline_ms, pred);
+    sleeping_.store(false, std::memory_order_relaxed);
+  }
+};
+
+
+
 // Main Controller Class
 // This class receives the data from the TCP/IP network handler class throughout
-// signal/slot pattern. Internally, it processes the received commands from
-// network in its process thread. The incoming request traffic is placed in
-// different priority queues for an effective handling.
+// signal/slot pattern. Internally, the received commands are processed by a
+// timer driven state machine of the car (departing, passing a floor,
+// arriving, doors open, doors closed) which never blocks. Its timed events
+// are scheduled on the timer wheel of a driver thread, so that new stops are
+// picked up while the car is moving and one thread is able to drive many cars.
 class ElevatorCtrl {
 public:
   // State of the elevator whether moving or stopped
-  enum class State : uint8_t { MOVING = 1, STOPPED };
+  using State = CarState;
 
   // State of the door; opened or closed
   enum class Door : uint8_t { OPEN = 1, CLOSED };
 
+  // State of the car as seen from other threads
+  struct Snapshot {
+    uint8_t location;
+    State state;
+    Door door;
+    Request::Direction direction;
+  };
+
+  // Simulated physical timings of the car
+  static const int64_t FLOOR_TRAVEL_MS = 1000;  // travelling between two floors
+  static const int64_t DOOR_DWELL_MS = 3000;    // doors open at a stop
+
+  // Capacity of the ingress ring between the network and the controller
+  static const size_t INGRESS_CAPACITY = 1024;
+
+  // Cost weights used by the group dispatcher. A pending stop costs about
+  // as much as travelling three floors (door dwell vs. floor travel) and
+  // a call behind the car has to wait for a full reversal.
+  static const uint32_t STOP_COST = DOOR_DWELL_MS / FLOOR_TRAVEL_MS;
+  static const uint32_t REVERSAL_COST = 256;
+
 private:
-  uint8_t location_;  // Location of elevator's car
-  Request::Direction direction_; // Holds direction of moving (Up/Down)
+  const uint8_t car_id_; // Index of this car in its group
+  // Location and direction are atomics so that the group controller can
+  // evaluate the dispatch cost of this car without taking its queue mutex.
+  std::atomic<uint8_t> location_;  // Location of elevator's car
+  std::atomic<Request::Direction> direction_; // Holds direction of moving (Up/Down)
   State state_; // Holds the state of the elevator (Moving/Stop)
   Door door_;   // Holds the state of the doors (Open/Close)
-
-  // The following queue, mutex, and condition variable are used for
-  // thread safe synchronization between pushing side of the incoming traffic
-  // into input queue and consuming side of the controller.
-  std::deque<int> inputQueue_;
-  std::mutex inputQueueMutex_;
-  std::condition_variable inputQueueCondVar_;
-
-  // tuple type Output items vector from network protocol handler task
-  std::tuple<uint16_t, uint16_t, uint8_t, uint8_t, uint8_t> output_items_;
+  std::atomic<uint32_t> pending_; // Number of queued requests not yet served
+
+  // Time source for time tags, car motion and timed waits
+  std::shared_ptr<Clock> clock_;
+
+  // Timed event of the state machine: passing the next floor while moving,
+  // or closing the doors while they are open. It lives on the timer wheel
+  // of the driver thread.
+  TimerWheel::Timer motionTimer_;
+  TimerWheel* timers_;
+
+  // The incoming traffic is handed over to the controller through a
+  // lock-free ring. The driver thread is only woken up when it is parked,
+  // so the network threads never contend with the scheduling.
+  MpscRing<Request> inputQueue_;
+  std::shared_ptr<Wakeup> wakeup_;
+
+  // Counters of the ingress path
+  std::atomic<uint64_t> enqueued_;
+  std::atomic<uint64_t> dropped_;
+  std::atomic<uint64_t> maxDepth_;
+  std::atomic<uint64_t> enqueueNsTotal_;
+  std::atomic<uint64_t> enqueueNsMax_;
+
+  // Queue depths exported as metrics, sampled by the driver thread: the
+  // ingress ring when it is drained and the pending stops per kind
+  std::shared_ptr<Gauge> ingressDepth_;
+  std::shared_ptr<Gauge> pendingStops_[StopTable::NUM_KINDS];
+
+  // Snapshot of the car's state. It is written by the driver thread on every
+  // change and read by the status queries of the network threads.
+  SeqLock<Snapshot> snapshot_;
+
+  // Signals and slots Observer Pattern which publishes every change of the
+  // car's position or state
+  std::shared_ptr<signal_slot<const CarStatus&>> onStatusChange_;
+
+  // Latency of the served requests in milliseconds, recorded by the driver
+  // thread: the wait from a hall call to the arrival of the car, per floor
+  // and direction (allocated on first use), and the ride from boarding at a
+  // hall call to the arrival at the destination of the passenger's car call.
+  // The wire format does not name the passenger of a car call, so a car
+  // call is tied, when it reaches the driver, to the earliest passenger who
+  // boarded at a hall call of the same requester node and has no car call
+  // yet. Car calls of other nodes (e.g. an in-car panel) are not recorded.
+  std::unique_ptr<std::atomic<LatencyHistogram*>[]> waitTimes_;
+  LatencyHistogram rideTimes_;
+  std::unordered_map<uint16_t, std::deque<int64_t>> boarded_;  // boarding times per requester node, earliest first
+  std::unordered_map<uint32_t, int64_t> riding_;                // boarding time per car call, by node and message id
 
 public:
   // ctor
-  ElevatorCtrl() : location_(0),
+  ElevatorCtrl(uint8_t car_id = 0, std::shared_ptr<Clock> clock = SystemClock::instance()) : car_id_(car_id),
+                   location_(0),
                    direction_(Request::Direction::UP),
 				   state_(State::STOPPED),
 				   door_(Door::CLOSED),
-				   output_items_(std::make_tuple(0, 0, 0, 0, 0)) {
-    onNewData_ = std::make_shared<signal_slot<std::tuple<uint16_t, uint16_t, uint8_t, uint8_t, uint8_t>&>>();
+				   pending_(0),
+				   clock_(clock),
+				   motionTimer_([this]() { onMotionTimer(); }),
+				   timers_(nullptr),
+				   inputQueue_(INGRESS_CAPACITY),
+				   wakeup_(std::make_shared<Wakeup>(clock)),
+				   enqueued_(0),
+				   dropped_(0),
+				   maxDepth_(0),
+				   enqueueNsTotal_(0),
+				   enqueueNsMax_(0),
+				   snapshot_(Snapshot{0, State::STOPPED, Door::CLOSED, Request::Direction::UP}),
+				   waitTimes_(new std::atomic<LatencyHistogram*>[FloorSet::MAX_FLOORS * 2]) {
+    onNewData_ = std::make_shared<signal_slot<const CarStatus&>>();
+    onStatusChange_ = std::make_shared<signal_slot<const CarStatus&>>();
+    for (size_t i = 0; i < FloorSet::MAX_FLOORS * 2; i++)
+      waitTimes_[i].store(nullptr, std::memory_order_relaxed);
+
+    std::string car = "car=\"" + std::to_string(car_id_) + "\"";
+    MetricsRegistry& metrics = MetricsRegistry::instance();
+    ingressDepth_ = metrics.gauge("elevator_ingress_depth", "Requests waiting in the ingress ring of a car.", car);
+    const char* kinds[StopTable::NUM_KINDS] = {"up", "down", "car"};
+    for (size_t i = 0; i < StopTable::NUM_KINDS; i++)
+      pendingStops_[i] = metrics.gauge("elevator_pending_stops", "Pending stops of a car by kind.", car + ",kind=\"" + kinds[i] + "\"");
   }
 
   // dtor
   ~ElevatorCtrl() {
     onNewData_ = nullptr;
+    onStatusChange_ = nullptr;
+    for (size_t i = 0; i < FloorSet::MAX_FLOORS * 2; i++)
+      delete waitTimes_[i].load(std::memory_order_relaxed);
   }
 
   // Signals and slots Observer Pattern which emits a new output data to the network protocol subsystem
-  void emitNewData() {
-    onNewData_->emit(output_items_);
+  void emitNewData(const CarStatus& status) {
+    onNewData_->emit(status);
   }
 
   // Getter interface for the new DATA Signal/Slot
-  std::shared_ptr<signal_slot<std::tuple<uint16_t, uint16_t, uint8_t, uint8_t, uint8_t>&>> getOnNewDataGen() { return onNewData_; };
+  std::shared_ptr<signal_slot<const CarStatus&>> getOnNewDataGen() { return onNewData_; };
+
+  // Getter interface for the status change Signal/Slot
+  std::shared_ptr<signal_slot<const CarStatus&>> getOnStatusChangeGen() { return onStatusChange_; };
+
+  // Index of this car in its group
+  uint8_t carId() const { return car_id_; }
+
+  // Consistent copy of the car's state; it may be called from any thread
+  // and never waits for the driver thread
+  Snapshot snapshot() const { return snapshot_.load(); }
+
+  // Assigns the wake-up primitive and the timer wheel of the driver thread
+  // of this car
+  void setDriver(std::shared_ptr<Wakeup> wakeup, TimerWheel* timers) {
+    wakeup_ = wakeup;
+    timers_ = timers;
+  }
+
+  // Driver side: true if new requests are waiting in the ingress ring
+  bool hasInput() const { return !inputQueue_.empty(); }
+
+  // Estimated cost for this car to serve a hall call at the given floor in
+  // the given direction. Only atomics are read, so the group controller can
+  // rank all cars while they keep running their own queues.
+  uint32_t callCost(uint8_t floor, Request::Direction direction) const {
+    uint8_t location = location_.load(std::memory_order_relaxed);
+    uint32_t distance = (floor >= location) ? floor - location : location - floor;
+    bool onTheWay = (direction_.load(std::memory_order_relaxed) == direction) &&
+                    ((direction == Request::Direction::UP) ? floor >= location : floor <= location);
+    return distance +
+           (onTheWay ? 0 : REVERSAL_COST) +
+           (pending_.load(std::memory_order_relaxed) + inputQueue_.size()) * STOP_COST;
+  }
+
+  // Snapshot of the ingress path counters
+  struct IngressStats {
+    uint64_t enqueued;        // requests handed over to the controller
+    uint64_t dropped;         // requests lost on a full ring
+    uint64_t depth;           // requests currently waiting in the ring
+    uint64_t maxDepth;        // high-water mark of the ring depth
+    uint64_t enqueueNsTotal;  // accumulated time spent in the producer path
+    uint64_t enqueueNsMax;    // slowest producer path
+  };
+
+  IngressStats ingressStats() const {
+    return IngressStats{enqueued_.load(std::memory_order_relaxed),
+                        dropped_.load(std::memory_order_relaxed),
+                        inputQueue_.size(),
+                        maxDepth_.load(std::memory_order_relaxed),
+                        enqueueNsTotal_.load(std::memory_order_relaxed),
+                        enqueueNsMax_.load(std::memory_order_relaxed)};
+  }
+
+  // Adds the wait times of the hall calls at the given floor in the given
+  // direction to the histogram; it may be called from any thread
+  void mergeWaitTimes(LatencyHistogram& out, uint8_t floor, Request::Direction direction) const {
+    if (const LatencyHistogram* waitTimes = waitTimes_[waitIndex(floor, direction)].load(std::memory_order_acquire))
+      out.merge(*waitTimes);
+  }
+
+  // Adds the wait times of all hall calls to the histogram
+  void mergeWaitTimes(LatencyHistogram& out) const {
+    for (size_t i = 0; i < FloorSet::MAX_FLOORS * 2; i++)
+      if (const LatencyHistogram* waitTimes = waitTimes_[i].load(std::memory_order_acquire))
+        out.merge(*waitTimes);
+  }
+
+  // Adds the ride times of the passengers to the histogram
+  void mergeRideTimes(LatencyHistogram& out) const {
+    out.merge(rideTimes_);
+  }
 
 private:
-  // priority queues for prioritizing the handling of input traffic
-  std::priority_queue<Request, std::vector<Request>, upComparator> upQueue_;
-  std::priority_queue<Request, std::vector<Request>, downComparator> downQueue_;
-  std::queue<Request> currentQueue_;
+  // Per-floor stop table of this car, owned by the process thread
+  StopTable stops_;
+  // Requests served at the last stop; reused to avoid allocations per stop
+  std::vector<Request> served_;
 
   // Signals and slots Observer Pattern which notifies the generation of a new OUTPUT DATA
-  std::shared_ptr<signal_slot<std::tuple<uint16_t, uint16_t, uint8_t, uint8_t, uint8_t>&>> onNewData_;
+  std::shared_ptr<signal_slot<const CarStatus&>> onNewData_;
 
 public:
   // Input callback method which is being called by the network layer as soon as
   // each input command request is being received
-  void input_data_consumer(std::tuple<uint16_t, uint16_t, uint8_t, uint8_t, uint8_t>& cmd_tuple) {
-    uint8_t cmd, floor_num, direction;
-    uint16_t node_addr, msg_id;
-    std::tie(node_addr, msg_id, cmd, floor_num, direction) = cmd_tuple;
-    std::cout << "input_data_consumer: (" << node_addr << "," << msg_id << "," << (cmd&0xFF) << "," << (floor_num&0xFF) << "," << (direction&0xFF) << ")" << std::endl;
-    switch (cmd) {
-      case 1: // call
-        call(node_addr, msg_id, floor_num, static_cast<Request::Direction>(direction));
+  void input_data_consumer(const CarCommand& command) {
+    LOG_DEBUG("input_data_consumer: ({},{},{},{},{})", command.node_addr, command.msg_id, command.cmd, command.floor, command.direction);
+    switch (command.cmd) {
+      case Request::Command::CALL:
+        call(command);
         break;
-      case 2: // go;
-        go(node_addr, msg_id, floor_num);
+      case Request::Command::GO:
+        go(command);
         break;
       default: // code to be executed if n doesn't match any cases
-        throw std::invalid_argument("Illegal command: " + std::to_string(cmd));
+        throw std::invalid_argument("Illegal command: " + std::to_string(static_cast<int>(command.cmd)));
     }
   }
 
@@ -152,181 +346,331 @@ private:
 
   // This method is being invoked based on each "call" command request
   // by user
-  void call(uint16_t node_addr, uint16_t msg_id, uint8_t floor, Request::Direction direction) {
-    std::unique_lock<std::mutex> locker(inputQueueMutex_);
+  void call(const CarCommand& command) {
+    addStop(Request(command.node_addr, command.msg_id, clock_->now_ms(), Request::Command::CALL, command.floor, command.direction));
+  }
 
-    if (direction == Request::Direction::UP) {
-      if (floor >= location_) {
-        currentQueue_.push(Request(node_addr, msg_id, current_time_ms(), static_cast<Request::Command>(0), floor, direction));
-      }
-      else {
-        upQueue_.push(Request(node_addr, msg_id, current_time_ms(), static_cast<Request::Command>(0), floor, direction));
-      }
-    } else {
-      if (floor <= location_) {
-        currentQueue_.push(Request(node_addr, msg_id, current_time_ms(), static_cast<Request::Command>(0), floor, direction));
-      } else {
-        downQueue_.push(Request(node_addr, msg_id, current_time_ms(), static_cast<Request::Command>(0), floor, direction));
-      }
+
+  // This method is being invoked based on each "go" command request
+  // by user
+  void go(const CarCommand& command) {
+    addStop(Request(command.node_addr, command.msg_id, clock_->now_ms(), Request::Command::GO, command.floor, direction_));
+  }
+
+
+  // Hands the request over to the driver thread. The ring is lock-free;
+  // a mutex is only taken when the driver is parked and has to be woken up.
+  void addStop(const Request& r) {
+    auto start = std::chrono::steady_clock::now();
+    if (!inputQueue_.try_push(r)) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      LOG_WARN("ElevatorCtrl[{}]: input queue full, request dropped: ({},{})", car_id_, r.node_addr_, r.msg_id_);
+      return;
     }
+    wakeup_->notify();  // Notify the driver thread, if it is parked.
 
-    locker.unlock();
-    inputQueueCondVar_.notify_one();  // Notify one waiting thread, if there is one.
+    uint64_t ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    enqueued_.fetch_add(1, std::memory_order_relaxed);
+    enqueueNsTotal_.fetch_add(ns, std::memory_order_relaxed);
+    update_max(enqueueNsMax_, ns);
+    update_max(maxDepth_, inputQueue_.size());
   }
 
 
-  // This method is being invoked based on each "go" command request
-  // by user
-  void go(uint16_t node_addr, uint16_t msg_id, uint8_t floor) {
-    call(node_addr, msg_id, floor, direction_);
+  // Raises the atomic to the given value if it is lower
+  static void update_max(std::atomic<uint64_t>& target, uint64_t value) {
+    uint64_t current = target.load(std::memory_order_relaxed);
+    while (current < value && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+  }
+
+
+  // Moves the requests waiting in the ingress ring into the stop table. A
+  // request for an already pending stop is merged into it.
+  void drainInputQueue() {
+    ingressDepth_->set(static_cast<int64_t>(inputQueue_.size()));
+    inputQueue_.consume_all([this](Request&& r) {
+      if (r.cmd_ == Request::Command::GO)
+        board(r);
+      stops_.add(r);
+      Tracer::event(TraceEvent::Type::QUEUED, car_id_, r.node_addr_, r.msg_id_, r.floor_, static_cast<uint8_t>(StopTable::kindOf(r)));
+    });
+    updatePending();
+  }
+
+
+  // Publishes the number of pending stops to the dispatcher and to the
+  // metrics
+  void updatePending() {
+    pending_.store(static_cast<uint32_t>(stops_.size()), std::memory_order_relaxed);
+    pendingStops_[0]->set(static_cast<int64_t>(stops_.size(StopTable::Kind::UP)));
+    pendingStops_[1]->set(static_cast<int64_t>(stops_.size(StopTable::Kind::DOWN)));
+    pendingStops_[2]->set(static_cast<int64_t>(stops_.size(StopTable::Kind::CAR)));
   }
 
 
-  // The process functor which is being called by internal thread
-  void process() {
-    auto sec = std::chrono::seconds(1);
-    Request r(0,0,0,static_cast<Request::Command>(0),0,static_cast<Request::Direction>(0));
-    bool gotToken = false;
-    std::unique_lock<std::mutex> locker(inputQueueMutex_);
-    inputQueueCondVar_.wait_for(locker, 2*sec, [&]() -> bool { return !upQueue_.empty() || !downQueue_.empty() || !currentQueue_.empty();} );  // Unlock mu and wait to be notified
+public:
+  // Driver side: takes over the new requests. Requests for the open stop are
+  // served right away and an idle car starts moving towards its next stop.
+  void poll(int64_t now) {
+    drainInputQueue();
+    if (state_ == State::MOVING) return;
+    if (door_ == Door::OPEN)
+      serveStop(now, location_, direction_);
+    else
+      depart(now);
+  }
 
-    if (!currentQueue_.empty()) {
-      r = currentQueue_.front();
-      currentQueue_.pop();
-      gotToken = true;
+private:
+  // Expiry of the motion timer. The event is processed at its own time
+  // stamp, so overdue events are replayed exactly.
+  void onMotionTimer() {
+    int64_t time = motionTimer_.expiry_ms();
+    if (state_ == State::MOVING) {
+      passFloor(time);
+    } else if (door_ == Door::OPEN) {
+      closeDoors();
+      depart(time);
+    }
+  }
+
+
+  // Idle car: picks the next stop of the LOOK sweep and starts moving
+  // towards it. Returns false if there is no pending stop.
+  bool depart(int64_t time) {
+    StopTable::Stop stop = stops_.next(location_, direction_);
+    if (stop.floor == FloorSet::NONE) return false;
+
+    if (stop.floor == location_) {
+      arrive(time, stop.direction);
     } else {
-      preProcessNextQueue();
+      LOG_INFO("goToFloor[{}]: moving to {}", car_id_, stop.floor);
+      turn((stop.floor > location_) ? Request::Direction::UP : Request::Direction::DOWN);
+      Tracer::event(TraceEvent::Type::DEPART, car_id_, 0, 0, static_cast<uint8_t>(stop.floor), static_cast<uint8_t>(direction_.load()));
+      state_ = State::MOVING;
+      timers_->schedule(motionTimer_, time + FLOOR_TRAVEL_MS);
+      publishStatus();
     }
-    locker.unlock();
-    if (gotToken) goToFloor(r.node_addr_, r.msg_id_, r.floor_);
+    return true;
   }
 
 
-  // This method simulates the actor which moves the elevator up/down and
-  // opens/closes the doors. By using some delays it simulates the physical
-  // nature of the elevator
-  void goToFloor(uint16_t node_addr, uint16_t msg_id, uint8_t floor) {
-    std::cout << "goToFloor: moving to " << (floor&0xFF) << std::endl;
-    state_ = State::MOVING;
-    for (uint8_t i = location_; i <= floor; i++) {
-      // Simulate the time which the elevator's car spends to traverse between floors
-      std::this_thread::sleep_until(std::chrono::system_clock::now() + std::chrono::seconds(1));
+  // Moving car: reaches the next floor. The next stop is looked up again on
+  // every floor, so stops added on the way are served in the same trip.
+  void passFloor(int64_t time) {
+    location_ = static_cast<uint8_t>((direction_ == Request::Direction::UP) ? location_ + 1 : location_ - 1);
+    Tracer::event(TraceEvent::Type::FLOOR, car_id_, 0, 0, location_, static_cast<uint8_t>(direction_.load()));
+    StopTable::Stop stop = stops_.next(location_, direction_);
+    if (stop.floor == FloorSet::NONE) stop.floor = location_;
 
-      ///////////////////////////////////////////////
-      // Sending the current status to the requester
-      output_items_ = std::make_tuple(node_addr, msg_id, 3, i, static_cast<uint8_t>(State::MOVING)); // status, floorNum, moving
+    ///////////////////////////////////////////////
+    // Sending the current status to the requester
+    if (stops_.has(static_cast<uint8_t>(stop.floor), StopTable::Kind::CAR) ||
+        stops_.has(static_cast<uint8_t>(stop.floor), (stop.direction == Request::Direction::UP) ? StopTable::Kind::UP : StopTable::Kind::DOWN)) {
+      const Request& lead = stops_.lead(static_cast<uint8_t>(stop.floor), stop.direction);
       // Emit the status request to the network protocol subsystem
-      emitNewData();
+      emitNewData(CarStatus{lead.node_addr_, lead.msg_id_, car_id_, location_.load(), State::MOVING, direction_.load()});
     }
-    location_ = floor;
-    door_ = Door::OPEN;
+
+    if (stop.floor == location_) {
+      arrive(time, stop.direction);
+    } else {
+      turn((stop.floor > location_) ? Request::Direction::UP : Request::Direction::DOWN);
+      timers_->schedule(motionTimer_, time + FLOOR_TRAVEL_MS);
+      publishStatus();
+    }
+  }
+
+
+  // The car stops at its current floor and opens the doors; the doors stay
+  // open for the dwell time
+  void arrive(int64_t time, Request::Direction direction) {
+    LOG_INFO("goToFloor[{}]: reached to {}", car_id_, location_.load());
     state_ = State::STOPPED;
+    turn(direction);
+    door_ = Door::OPEN;
+    Tracer::event(TraceEvent::Type::DOOR_OPEN, car_id_, 0, 0, location_, static_cast<uint8_t>(direction));
+    timers_->schedule(motionTimer_, time + DOOR_DWELL_MS);
+    publishStatus();
+    serveStop(time, location_, direction);
+  }
 
-    ///////////////////////////////////////////////
-    // Sending the current status to the requester
-    output_items_ = std::make_tuple(node_addr, msg_id, 3, floor, static_cast<uint8_t>(State::STOPPED)); // status, floorNum, stop
-    // Emit the status request to the network protocol subsystem
-    emitNewData();
 
-    // Simulate the time which the elevator's car stays at the destination
-    std::this_thread::sleep_until(std::chrono::system_clock::now() + std::chrono::seconds(3));
-    door_ = Door::CLOSED;
+  // Sets the sweep direction of the car; a reversal is traced
+  void turn(Request::Direction direction) {
+    if (direction_.load(std::memory_order_relaxed) != direction)
+      Tracer::event(TraceEvent::Type::DIRECTION, car_id_, 0, 0, location_, static_cast<uint8_t>(direction));
+    direction_ = direction;
+  }
+
 
-    std::cout << "goToFloor: reached to " << floor << std::endl;
+  // Publishes the current position and state of the car to the snapshot
+  // and to the subscribed displays
+  void publishStatus() {
+    updateSnapshot();
+    onStatusChange_->emit(CarStatus{Net::MsgProtocol::BROADCAST_ADDRESS, 0, car_id_, location_.load(), state_, direction_.load()});
   }
 
-private:
-  // This method prepares the current queue based on moving the content of
-  // up/down priority queue into the normal queue. Basically, the algorithm
-  // beneath this method tries to get service to all the requests in the
-  // current direction of the movement.
-  void preProcessNextQueue() {
-    if (getLowestTimeUpQueue() > getLowestTimeDownQueue()) {
-      direction_ = Request::Direction::UP;
-      while (!upQueue_.empty()) {
-    	currentQueue_.push(std::move(const_cast<Request&>(upQueue_.top())));
-        upQueue_.pop();
-      }
-    } else {
-      direction_ = Request::Direction::DOWN;
-      while (!downQueue_.empty()) {
-    	currentQueue_.push(std::move(const_cast<Request&>(downQueue_.top())));
-    	downQueue_.pop();
-      }
-    }
+
+  void updateSnapshot() {
+    snapshot_.store(Snapshot{location_.load(std::memory_order_relaxed), state_, door_, direction_.load(std::memory_order_relaxed)});
   }
 
 
-  // This method returns the time tag of the element in the Up Queue
-  // with the least time tag
-  int64_t getLowestTimeUpQueue() {
-	int64_t lowest = LONG_MAX;
-    while (!upQueue_.empty()) {
-      if (upQueue_.top().time_ < lowest)
-        lowest = upQueue_.top().time_;
-    }
-    return lowest;
+  // The dwell time is over and the doors close
+  void closeDoors() {
+    door_ = Door::CLOSED;
+    Tracer::event(TraceEvent::Type::DOOR_CLOSE, car_id_, 0, 0, location_, 0);
+    updateSnapshot();
   }
 
 
-  // This method returns the time tag of the element in the Down Queue
-  // with the least time tag
-  int64_t getLowestTimeDownQueue() {
-	int64_t lowest = LONG_MAX;
-    while (!downQueue_.empty()) {
-      if (downQueue_.top().time_ < lowest)
-        lowest = downQueue_.top().time_;
+  // This method clears the stop at the reached floor and reports the arrival
+  // to every request which was merged into it
+  void serveStop(int64_t time, uint8_t floor, Request::Direction direction) {
+    served_.clear();
+    stops_.serve(floor, direction, served_);
+    updatePending();
+
+    for (const auto& r : served_) {
+      recordLatency(time, r);
+      ///////////////////////////////////////////////
+      // Sending the current status to the requester
+      // Emit the status request to the network protocol subsystem
+      emitNewData(CarStatus{r.node_addr_, r.msg_id_, car_id_, floor, State::STOPPED, direction});
     }
-    return lowest;
   }
 
 
-  // Process task which is derived from the stoppable thread for
-  // easy stopping
-  class Process : public Stoppable {
-  private:
-    ElevatorCtrl* parent_;
+  static size_t waitIndex(uint8_t floor, Request::Direction direction) {
+    return floor * 2 + ((direction == Request::Direction::UP) ? 0 : 1);
+  }
+
+
+  static uint32_t rideKey(const Request& r) {
+    return (static_cast<uint32_t>(r.node_addr_) << 16) | r.msg_id_;
+  }
 
-  public:
-    // ctor
-    Process(ElevatorCtrl* parent) : parent_(parent) {}
 
-    // dtor
-    ~Process() {}
+  // Ties a car call to the earliest boarded passenger of its requester node
+  void board(const Request& r) {
+    auto it = boarded_.find(r.node_addr_);
+    if (it == boarded_.end())
+      return;
+    riding_[rideKey(r)] = it->second.front();
+    it->second.pop_front();
+    if (it->second.empty())
+      boarded_.erase(it);
+  }
 
-    // Thread loop method
-    void run() {
-      std::cout << "ElevatorCtrl Process Start" << std::endl;
-      while (stopRequested() == false) {
-        parent_->process();
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+  // A served hall call ends the passenger's wait and starts the ride, the
+  // served car call tied to the passenger ends the ride
+  void recordLatency(int64_t time, const Request& r) {
+    uint64_t elapsed = static_cast<uint64_t>(std::max(time - r.time_, int64_t(0)));
+    if (r.cmd_ == Request::Command::CALL) {
+      auto& slot = waitTimes_[waitIndex(r.floor_, r.direction_)];
+      LatencyHistogram* waitTimes = slot.load(std::memory_order_relaxed);
+      if (waitTimes == nullptr) {
+        waitTimes = new LatencyHistogram();
+        slot.store(waitTimes, std::memory_order_release);
       }
-      std::cout << "ElevatorCtrl Process End" << std::endl;
+      waitTimes->record(elapsed);
+      boarded_[r.node_addr_].push_back(time);
+    } else {
+      auto it = riding_.find(rideKey(r));
+      if (it == riding_.end()) return;
+      rideTimes_.record(static_cast<uint64_t>(std::max(time - it->second, int64_t(0))));
+      riding_.erase(it);
     }
-  };
+  }
+};
+
 
 
+// Driver task which is derived from the stoppable thread for easy stopping.
+// It drives the state machines of one or more cars. Their timed events are
+// kept on a single timer wheel, and the thread parks until the earliest of
+// them expires or until a new request or a stop request arrives.
+class CarDriver : public Stoppable {
+private:
+  std::shared_ptr<Clock> clock_;
+  std::shared_ptr<Wakeup> wakeup_;
+  TimerWheel timers_;  // declared before the cars, which cancel their timers on destruction
+  std::vector<std::shared_ptr<ElevatorCtrl>> cars_;
+
+  // Time per iteration of the thread loop without its wait, in nanoseconds
+  std::shared_ptr<LatencyHistogram> iterationTime_;
+
   // Task process variables
-  std::unique_ptr<ElevatorCtrl::Process> taskProcess;
   std::thread processingThread;
 
 public:
+  // ctor
+  CarDriver(std::shared_ptr<Clock> clock = SystemClock::instance(), size_t id = 0) :
+      clock_(clock),
+      wakeup_(std::make_shared<Wakeup>(clock)),
+      timers_(clock->now_ms()),
+      iterationTime_(MetricsRegistry::instance().summary("elevator_driver_iteration_seconds",
+                                                         "Time per iteration of a car driver thread.",
+                                                         "driver=\"" + std::to_string(id) + "\"")) {
+    // A stop request wakes the thread up from its wait
+    onStop([this]() { wakeup_->notify(); });
+  }
+
+  // dtor
+  ~CarDriver() {
+    stop_process_thread();
+    join_process_thread();
+  }
+
+  // Adds a car to this driver; must be called before the thread starts
+  void add(std::shared_ptr<ElevatorCtrl> car) {
+    car->setDriver(wakeup_, &timers_);
+    cars_.push_back(car);
+  }
+
+  // Thread loop method
+  void run() {
+    LOG_INFO("CarDriver Process Start ({} cars)", cars_.size());
+    clock_->attach();
+    while (stopRequested() == false) {
+      auto start = std::chrono::steady_clock::now();
+      int64_t now = clock_->now_ms();
+      for (auto& car : cars_)
+        car->poll(now);
+      timers_.advance(now);
+      iterationTime_->record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()));
+
+      // Without any pending timer (NEVER is the clock's NO_DEADLINE) the
+      // thread sleeps until a new request or a stop request wakes it up
+      wakeup_->wait_until_ms(timers_.next_expiry_ms(), [&]() -> bool {
+        if (stopRequested()) return true;
+        for (auto& car : cars_)
+          if (car->hasInput()) return true;
+        return false;
+      });
+    }
+    clock_->detach();
+    LOG_INFO("CarDriver Process End");
+  }
+
+
   // Helper method for creating the process thread
   void make_process_thread() {
-    if (taskProcess) return;
+    if (processingThread.joinable()) return;
 
-    taskProcess = std::unique_ptr<ElevatorCtrl::Process>(new ElevatorCtrl::Process(this));
-    std::cout << "Starting elevator controller processing task..." << std::endl;
-    processingThread = std::thread([&]()
+    LOG_INFO("Starting elevator controller processing task...");
+    reset();
+    processingThread = std::thread([this]()
     {
-      taskProcess->run();
+      run();
     });
   }
 
 
   // Helper method for stopping the process thread
   void stop_process_thread() {
-    if(processingThread.joinable()) { if (taskProcess) taskProcess->stop(); }
+    if(processingThread.joinable()) stop();
   }
 
 
@@ -338,31 +682,215 @@ public:
 
 
 
+// Group Controller Class
+// This class owns a bank of cars and acts as the single consumer of the
+// network protocol handler. Each hall call is assigned to the car with the
+// lowest estimated cost and handed over to that car's own input queue, so
+// every car keeps scheduling on its own shard (stop table, ingress ring and
+// driver) and there is no lock shared between the cars. "Go" commands are
+// issued from inside a car; they are routed to the car which was last
+// assigned to the requesting node.
+class ElevatorGroupCtrl : noncopyable {
+private:
+  // Cars of this group and the driver threads stepping them
+  std::vector<std::shared_ptr<ElevatorCtrl>> cars_;
+  std::vector<std::shared_ptr<CarDriver>> drivers_;
+
+  // Car index of the last hall call assigned per requester node address.
+  // It is indexed directly by the 16-bit node address for an O(1) lookup.
+  std::unique_ptr<std::atomic<uint8_t>[]> nodeCar_;
+
+  // Signals and slots Observer Pattern which forwards the output data of all
+  // cars to the network protocol subsystem
+  std::shared_ptr<signal_slot<const CarStatus&>> onNewData_;
+
+  // Signals and slots Observer Pattern which forwards the status changes of
+  // all cars
+  std::shared_ptr<signal_slot<const CarStatus&>> onStatusChange_;
+
+  // Received requests per command (call, go, query)
+  std::shared_ptr<Counter> requests_[3];
+
+public:
+  // ctor
+  ElevatorGroupCtrl(size_t num_cars = 1, std::shared_ptr<Clock> clock = SystemClock::instance(), size_t cars_per_thread = 1) :
+      nodeCar_(new std::atomic<uint8_t>[std::numeric_limits<uint16_t>::max() + 1]) {
+    if (num_cars == 0 || num_cars > std::numeric_limits<uint8_t>::max())
+      throw std::invalid_argument("Illegal number of cars: " + std::to_string(num_cars));
+    if (cars_per_thread == 0)
+      throw std::invalid_argument("Illegal number of cars per thread: 0");
+
+    for (size_t i = 0; i <= std::numeric_limits<uint16_t>::max(); i++)
+      nodeCar_[i].store(0, std::memory_order_relaxed);
+
+    const char* commands[3] = {"call", "go", "query"};
+    for (size_t i = 0; i < 3; i++)
+      requests_[i] = MetricsRegistry::instance().counter("elevator_requests_total", "Requests received by the group controller by command.",
+                                                         std::string("command=\"") + commands[i] + "\"");
+
+    onNewData_ = std::make_shared<signal_slot<const CarStatus&>>();
+    onStatusChange_ = std::make_shared<signal_slot<const CarStatus&>>();
+    for (size_t i = 0; i < num_cars; i++) {
+      auto car = std::make_shared<ElevatorCtrl>(static_cast<uint8_t>(i), clock);
+      auto onNewData = onNewData_;
+      car->getOnNewDataGen()->connect([onNewData](const CarStatus& status) {
+        onNewData->emit(status);
+      });
+      auto onStatusChange = onStatusChange_;
+      car->getOnStatusChangeGen()->connect([onStatusChange](const CarStatus& status) {
+        onStatusChange->emit(status);
+      });
+      cars_.push_back(car);
+
+      if (i % cars_per_thread == 0)
+        drivers_.push_back(std::make_shared<CarDriver>(clock, drivers_.size()));
+      drivers_.back()->add(car);
+    }
+  }
+
+  // dtor
+  ~ElevatorGroupCtrl() {
+    drivers_.clear();
+    cars_.clear();
+    onNewData_ = nullptr;
+    onStatusChange_ = nullptr;
+  }
+
+  // Getter interface for the new DATA Signal/Slot
+  std::shared_ptr<signal_slot<const CarStatus&>> getOnNewDataGen() { return onNewData_; };
+
+  // Getter interface for the status change Signal/Slot of all cars
+  std::shared_ptr<signal_slot<const CarStatus&>> getOnStatusChangeGen() { return onStatusChange_; };
+
+  // Number of cars in this group
+  size_t size() const { return cars_.size(); }
+
+  // Getter interface for a single car
+  std::shared_ptr<ElevatorCtrl> car(size_t idx) { return cars_.at(idx); }
+
+  // Number of driver threads of this group
+  size_t num_drivers() const { return drivers_.size(); }
+
+  // Getter interface for a single driver
+  std::shared_ptr<CarDriver> driver(size_t idx) { return drivers_.at(idx); }
+
+  // Input callback method which is being called by the network layer as soon as
+  // each input command request is being received. A status query is answered
+  // right away from the snapshot of the car, on the calling thread.
+  void input_data_consumer(const CarCommand& command) {
+    size_t idx = 0;
+    switch (command.cmd) {
+      case Request::Command::QUERY:
+        requests_[2]->add();
+        query(command.node_addr, command.msg_id, command.floor);
+        return;
+      case Request::Command::CALL:
+        idx = assign(command.floor, command.direction);
+        nodeCar_[command.node_addr].store(static_cast<uint8_t>(idx), std::memory_order_relaxed);
+        break;
+      case Request::Command::GO:
+        idx = nodeCar_[command.node_addr].load(std::memory_order_relaxed);
+        break;
+      default:
+        throw std::invalid_argument("Illegal command: " + std::to_string(static_cast<int>(command.cmd)));
+    }
+    requests_[static_cast<size_t>(command.cmd) - 1]->add();
+    Tracer::event(TraceEvent::Type::ACCEPTED, static_cast<uint8_t>(idx), command.node_addr, command.msg_id, command.floor, static_cast<uint8_t>(command.cmd));
+    cars_[idx]->input_data_consumer(command);
+  }
+
+  // Reports the current floor and state of a car to the requester. Only the
+  // snapshot of the car is read, so the car's driver is neither locked nor
+  // woken up.
+  void query(uint16_t node_addr, uint16_t msg_id, uint8_t car_id) {
+    if (car_id >= cars_.size())
+      throw std::invalid_argument("Illegal car index: " + std::to_string(car_id));
+    ElevatorCtrl::Snapshot snapshot = cars_[car_id]->snapshot();
+    onNewData_->emit(CarStatus{node_addr, msg_id, car_id, snapshot.location, snapshot.state, snapshot.direction});
+  }
+
+  // Wait times of the hall calls at the given floor in the given direction
+  // over all cars, in milliseconds
+  void waitTimes(LatencyHistogram& out, uint8_t floor, Request::Direction direction) const {
+    for (auto& car : cars_) car->mergeWaitTimes(out, floor, direction);
+  }
+
+  // Wait times of all hall calls over all cars, in milliseconds
+  void waitTimes(LatencyHistogram& out) const {
+    for (auto& car : cars_) car->mergeWaitTimes(out);
+  }
+
+  // Ride times of the passengers over all cars, in milliseconds
+  void rideTimes(LatencyHistogram& out) const {
+    for (auto& car : cars_) car->mergeRideTimes(out);
+  }
+
+  // Returns the index of the car with the lowest cost for serving a hall call
+  // at the given floor in the given direction
+  size_t assign(uint8_t floor, Request::Direction direction) const {
+    size_t best = 0;
+    uint32_t bestCost = std::numeric_limits<uint32_t>::max();
+    for (size_t i = 0; i < cars_.size(); i++) {
+      uint32_t cost = cars_[i]->callCost(floor, direction);
+      if (cost < bestCost) {
+        bestCost = cost;
+        best = i;
+      }
+    }
+    return best;
+  }
+
+  // Helper method for creating the driver threads
+  void make_process_threads() {
+    for (auto& driver : drivers_) driver->make_process_thread();
+  }
+
+  // Helper method for stopping the driver threads
+  void stop_process_threads() {
+    for (auto& driver : drivers_) driver->stop_process_thread();
+  }
+
+  // Wrapper method to join the driver threads
+  void join_process_threads() {
+    for (auto& driver : drivers_) driver->join_process_thread();
+  }
+};
+
+
+
 // The main elevator class which creates the whole system including the
 // controller and the network classes.
 class Elevator : noncopyable
 {
 private:
-  // Elevator controller
-  std::shared_ptr<ElevatorCtrl> elevatorCtrl;
+  // Elevator group controller
+  std::shared_ptr<ElevatorGroupCtrl> elevatorCtrl;
   // Network handler
   std::shared_ptr<Net::NetProtocol> taskNetProtocol;
   std::thread netProtocolThread;
+  // Metrics exporter
+  std::shared_ptr<Net::MetricsExporter> taskMetricsExporter;
+  std::thread metricsExporterThread;
+  // Event trace file written while the system runs, relative to the working
+  // directory unless it is an absolute path; empty for none
+  std::string traceFile;
 
 public:
 
   // ctor
-  Elevator(const char* cfg_file_name) {
-    elevatorCtrl = std::shared_ptr<ElevatorCtrl>(new ElevatorCtrl());
-    taskNetProtocol = std::shared_ptr<Net::NetProtocol>(new Net::NetProtocol());
+  Elevator(const char* cfg_file_name, size_t num_cars = 1, const std::string& trace_file = "elevator.trace") : traceFile(trace_file) {
+    elevatorCtrl = std::shared_ptr<ElevatorGroupCtrl>(new ElevatorGroupCtrl(num_cars));
+    taskNetProtocol = std::shared_ptr<Net::NetProtocol>(new Net::NetProtocol(nullptr, num_cars));
+    taskMetricsExporter = std::shared_ptr<Net::MetricsExporter>(new Net::MetricsExporter());
   }
 
 
   // dtor
   virtual ~Elevator() {
-    std::cout << "Dtor the elevator system..." << std::endl;
+    LOG_INFO("Dtor the elevator system...");
     stop();
 
+    if (taskMetricsExporter) taskMetricsExporter = nullptr;
     if (taskNetProtocol) taskNetProtocol = nullptr;
     if (elevatorCtrl) elevatorCtrl = nullptr;
   }
@@ -371,32 +899,52 @@ public:
   // Helper method to connect the signal and slot methods in the
   // network and controller sub-classes
   void connect_signal_slot() {
-    taskNetProtocol->getOnNewDataGen()->connect_member<ElevatorCtrl>(elevatorCtrl, &ElevatorCtrl::input_data_consumer);
+    taskNetProtocol->getOnNewDataGen()->connect_member<ElevatorGroupCtrl>(elevatorCtrl, &ElevatorGroupCtrl::input_data_consumer);
     elevatorCtrl->getOnNewDataGen()->connect_member<Net::NetProtocol>(taskNetProtocol, &Net::NetProtocol::input_data_consumer);
+    elevatorCtrl->getOnStatusChangeGen()->connect_member<Net::NetProtocol>(taskNetProtocol, &Net::NetProtocol::publish);
   }
 
 
   // Main routine to run the elevator system
   void run() {
-    std::cout << "Starting the elevator system..." << std::endl;
-    elevatorCtrl->make_process_thread();
+    LOG_INFO("Starting the elevator system...");
+    if (!traceFile.empty()) {
+      try {
+        Tracer::instance().open(traceFile);
+      } catch (const std::exception& e) {
+        LOG_WARN("Tracing disabled: {}", e.what());
+      }
+    }
+    elevatorCtrl->make_process_threads();
+    taskNetProtocol->reset();
     netProtocolThread = std::thread([&]()
     {
       taskNetProtocol->run();
     });
+    taskMetricsExporter->reset();
+    metricsExporterThread = std::thread([&]()
+    {
+      taskMetricsExporter->run();
+    });
 
-    elevatorCtrl->join_process_thread();
-    ThreadJoiner netProtocolThreadJoin(netProtocolThread);
+    elevatorCtrl->join_process_threads();
+    {
+      ThreadJoiner netProtocolThreadJoin(netProtocolThread);
+      ThreadJoiner metricsExporterThreadJoin(metricsExporterThread);
+    }
+    // The trace is closed once all the traced threads are gone
+    Tracer::instance().close();
 
-    std::cout << "Exiting the elevator system." << std::endl;
+    LOG_INFO("Exiting the elevator system.");
   }
 
 
   // Routine to stop the elevator system
   void stop() {
-    std::cout << "Stopping the elevator system..." << std::endl;
+    LOG_INFO("Stopping the elevator system...");
     if(netProtocolThread.joinable()) { if (taskNetProtocol) taskNetProtocol->stop(); }
-    if (elevatorCtrl) elevatorCtrl->stop_process_thread();
+    if(metricsExporterThread.joinable()) { if (taskMetricsExporter) taskMetricsExporter->stop(); }
+    if (elevatorCtrl) elevatorCtrl->stop_process_threads();
   }
 };
 
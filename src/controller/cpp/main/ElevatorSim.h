@@ -0,0 +1,116 @@
+/*
+ * @file   ElevatorSim.h
+ * @author Armin Zare Zadeh, ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   Discrete-event simulation mode of the elevator system.
+ *          The group controller runs on a virtual clock and replays
+ *          a scheduled traffic scenario without any network traffic,
+ *          taking the same scheduling decisions as in real time.
+ */
+
+#ifndef D_ELEVATOR_SIM_H
+#define D_ELEVATOR_SIM_H
+
+#include "Elevator.h"
+#include "Clock.h"
+
+#include <vector>
+#include <memory>
+#include <functional>
+#include <iostream>
+
+
+
+// Simulation driver class. The traffic scenario is scheduled as timed events
+// on the virtual clock. Every status emitted by the cars is recorded together
+// with its virtual time stamp, so different scheduler versions can be
+// compared on the same scenario.
+class ElevatorSimulator : noncopyable {
+public:
+  // Status report of a car recorded during the simulation
+  struct StatusRecord {
+    int64_t time_ms;
+    uint16_t node_addr;
+    uint16_t msg_id;
+    uint8_t floor;
+    ElevatorCtrl::State state;
+  };
+
+private:
+  std::shared_ptr<VirtualClock> clock_;
+  std::shared_ptr<ElevatorGroupCtrl> group_;
+  std::vector<StatusRecord> log_;
+  bool started_;
+  bool stopped_;
+
+public:
+  // ctor
+  ElevatorSimulator(size_t num_cars = 1, int64_t start_ms = 0, size_t cars_per_thread = 1) :
+      clock_(std::make_shared<VirtualClock>(start_ms)),
+      started_(false),
+      stopped_(false) {
+    group_ = std::make_shared<ElevatorGroupCtrl>(num_cars, clock_, cars_per_thread);
+    group_->getOnNewDataGen()->connect([this](const CarStatus& status) {
+      log_.push_back(StatusRecord{clock_->now_ms(), status.node_addr, status.msg_id, status.floor, status.state});
+    });
+  }
+
+  // dtor
+  ~ElevatorSimulator() {
+    stop();
+  }
+
+  // Schedules a user request at the given virtual time
+  void schedule(int64_t time_ms, uint16_t node_addr, uint16_t msg_id,
+                Request::Command cmd, uint8_t floor, Request::Direction direction) {
+    auto group = group_;
+    CarCommand command{node_addr, msg_id, cmd, floor, direction};
+    clock_->schedule(time_ms, [group, command]() { group->input_data_consumer(command); });
+  }
+
+  // Schedules a callback at the given virtual time, e.g. requesters which
+  // send their frames through a loopback transport and a poll of it. It
+  // runs while all cars wait for the virtual time to advance.
+  void schedule(int64_t time_ms, std::function<void ()> event) {
+    clock_->schedule(time_ms, std::move(event));
+  }
+
+  // Runs the simulation up to the given virtual time. It may be called
+  // repeatedly to advance the simulation step by step.
+  void run_until(int64_t end_ms) {
+    if (stopped_) return;
+    if (!started_) {
+      // Drivers are attached one after another so that their order in the
+      // event queue does not depend on the thread start up
+      for (size_t i = 0; i < group_->num_drivers(); i++) {
+        group_->driver(i)->make_process_thread();
+        clock_->wait_attached(i + 1);
+      }
+      started_ = true;
+    }
+    clock_->run_until(end_ms);
+  }
+
+  // Stops the car threads and releases them from the virtual clock. The
+  // simulation cannot be resumed afterwards.
+  void stop() {
+    if (!started_ || stopped_) return;
+    group_->stop_process_threads();
+    clock_->shutdown();
+    group_->join_process_threads();
+    stopped_ = true;
+  }
+
+  // Current virtual time
+  int64_t now_ms() { return clock_->now_ms(); }
+
+  // Recorded status reports of the cars
+  const std::vector<StatusRecord>& log() const { return log_; }
+
+  // Getter interface for the simulated group controller
+  std::shared_ptr<ElevatorGroupCtrl> group() { return group_; }
+};
+
+
+#endif /* D_ELEVATOR_SIM_H */
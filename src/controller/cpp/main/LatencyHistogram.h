@@ -0,0 +1,167 @@
+/*
+ * @file   LatencyHistogram.h
+ * @author Armin Zare Zadeh, ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   HDR-style latency histograms with a bounded relative error.
+ *          They are being used for tracking the wait and ride times of
+ *          the passengers and the ACK latency of the protocol handler.
+ */
+
+#ifndef D_LATENCY_HISTOGRAM_H
+#define D_LATENCY_HISTOGRAM_H
+
+#include "NonCopyable.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+
+
+// Log-linear histogram: the values below 2^SUB_BUCKET_BITS have a bucket of
+// their own, every higher power of two range is split into 2^SUB_BUCKET_BITS
+// equal buckets. The bucket of a value is found with one bit scan, and every
+// value is reported with a relative error below 2^-SUB_BUCKET_BITS (about
+// 3 %). The unit of the values is up to the user.
+//
+// The counters are relaxed atomics: a histogram may be recorded by any
+// thread and read at any time, e.g. while it is being merged for a query.
+// Merging histograms is a plain addition of their buckets.
+class LatencyHistogram : noncopyable {
+public:
+  static const int SUB_BUCKET_BITS = 5;
+  static const int MAX_VALUE_BITS = 40;  // larger values are clamped
+  static const size_t NUM_BUCKETS = static_cast<size_t>(MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) << SUB_BUCKET_BITS;
+
+private:
+  std::atomic<uint64_t> counts_[NUM_BUCKETS];
+  std::atomic<uint64_t> count_;
+  std::atomic<uint64_t> sum_;
+  std::atomic<uint64_t> max_;
+
+public:
+  // ctor
+  LatencyHistogram() {
+    reset();
+  }
+
+  // Records one value
+  void record(uint64_t value) {
+    counts_[bucket(value)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+    uint64_t current = max_.load(std::memory_order_relaxed);
+    while (current < value && !max_.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+  }
+
+  // Adds the values recorded by another histogram
+  void merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < NUM_BUCKETS; i++) {
+      uint64_t n = other.counts_[i].load(std::memory_order_relaxed);
+      if (n != 0) counts_[i].fetch_add(n, std::memory_order_relaxed);
+    }
+    count_.fetch_add(other.count_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    sum_.fetch_add(other.sum_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    uint64_t value = other.max_.load(std::memory_order_relaxed);
+    uint64_t current = max_.load(std::memory_order_relaxed);
+    while (current < value && !max_.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+  }
+
+  void reset() {
+    for (auto& count : counts_) count.store(0, std::memory_order_relaxed);
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+  }
+
+  uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+  uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+  uint64_t sum() const { return sum_.load(std::memory_order_relaxed); }
+
+  double mean() const {
+    uint64_t n = count();
+    return (n == 0) ? 0.0 : static_cast<double>(sum()) / n;
+  }
+
+  // Value below or at which the given percentage (0..100) of the recorded
+  // values lie. It is the highest value of the bucket it falls into, but
+  // never above the recorded maximum. Returns 0 for an empty histogram.
+  uint64_t percentile(double percent) const {
+    uint64_t n = count();
+    if (n == 0) return 0;
+    uint64_t rank = static_cast<uint64_t>(percent / 100.0 * n + 0.5);
+    rank = std::min(std::max(rank, uint64_t(1)), n);
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < NUM_BUCKETS; i++) {
+      seen += counts_[i].load(std::memory_order_relaxed);
+      if (seen >= rank) return std::min(highest(i), max());
+    }
+    return max();
+  }
+
+  // Index of the bucket of a value
+  static size_t bucket(uint64_t value) {
+    const uint64_t SUB_BUCKETS = uint64_t(1) << SUB_BUCKET_BITS;
+    if (value < SUB_BUCKETS) return static_cast<size_t>(value);
+    int magnitude = 63 - __builtin_clzll(value);
+    if (magnitude >= MAX_VALUE_BITS) return NUM_BUCKETS - 1;
+    int shift = magnitude - SUB_BUCKET_BITS;
+    uint64_t sub = (value >> shift) - SUB_BUCKETS;
+    return static_cast<size_t>((static_cast<uint64_t>(shift + 1) << SUB_BUCKET_BITS) + sub);
+  }
+
+  // Highest value of a bucket
+  static uint64_t highest(size_t index) {
+    const uint64_t SUB_BUCKETS = uint64_t(1) << SUB_BUCKET_BITS;
+    if (index < SUB_BUCKETS) return index;
+    int shift = static_cast<int>(index >> SUB_BUCKET_BITS) - 1;
+    uint64_t sub = index & (SUB_BUCKETS - 1);
+    return ((SUB_BUCKETS + sub + 1) << shift) - 1;
+  }
+};
+
+
+
+// Histogram recorded by many threads. Every thread records into a shard of
+// its own, so the threads do not contend on the counters; a query merges
+// the shards. Threads beyond the number of shards share them.
+class ShardedHistogram : noncopyable {
+public:
+  static const size_t SHARDS = 16;
+
+private:
+  std::unique_ptr<LatencyHistogram> shards_[SHARDS];
+
+public:
+  // Small index of the calling thread, assigned on its first use; it is
+  // shared by all sharded counters
+  static size_t threadIndex() {
+    static std::atomic<size_t> next(0);
+    static thread_local size_t index = next.fetch_add(1, std::memory_order_relaxed);
+    return index;
+  }
+
+  // ctor
+  ShardedHistogram() {
+    for (auto& shard : shards_) shard.reset(new LatencyHistogram());
+  }
+
+  void record(uint64_t value) {
+    shards_[threadIndex() % SHARDS]->record(value);
+  }
+
+  // Adds the values of all shards to the given histogram
+  void mergeInto(LatencyHistogram& out) const {
+    for (auto& shard : shards_) out.merge(*shard);
+  }
+
+  void reset() {
+    for (auto& shard : shards_) shard->reset();
+  }
+};
+
+
+#endif /* D_LATENCY_HISTOGRAM_H */
@@ -0,0 +1,489 @@
+/*
+ * @file   Logger.h
+ * @author Armin Zare Zadeh, ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   Asynchronous leveled logger. The logging threads store binary
+ *          records into per-thread rings, and a background thread formats
+ *          and writes them out, so no terminal I/O happens on the request
+ *          path. Debug records are compiled out of builds with NDEBUG.
+ */
+
+#ifndef D_LOGGER_H
+#define D_LOGGER_H
+
+#include "NonCopyable.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+
+
+// Lowest level which is compiled in: 0 debug, 1 info, 2 warning, 3 error.
+// By default the debug records (packet dumps) are only compiled into the
+// builds without NDEBUG.
+#ifndef LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define LOG_MIN_LEVEL 1
+#else
+#define LOG_MIN_LEVEL 0
+#endif
+#endif
+
+
+// Severity of a log record. (ERROR is a macro of the Windows headers.)
+enum class LogLevel : uint8_t { DEBUG = 0, INFO, WARN, ERR };
+
+
+
+// A log call stores the address of its format string, a time stamp and its
+// arguments in binary form into a fixed-size record of the calling thread's
+// ring; there is no lock, no allocation and no formatting on this path. The
+// format string must be a literal, as only its address is kept. Each "{}" in
+// it is replaced by the next argument. A full ring drops the record instead
+// of blocking the caller, and the drops are reported in the log.
+//
+// The flusher thread merges the records of all threads in time stamp order,
+// formats them and writes them to the sink in one go per pass. It sleeps
+// while the rings are empty and is only woken up by the first record after
+// that.
+class Logger : noncopyable {
+public:
+  // Size of a record and number of records per thread
+  static const size_t RECORD_SIZE = 256;
+  static const size_t RING_CAPACITY = 1024;
+
+  // Time the flusher waits for more records after a pass, so that a burst
+  // is written out in few large writes
+  static const int64_t LINGER_MS = 10;
+
+  // Argument printed in hexadecimal
+  struct Hex { uint64_t value; };
+  // Argument printed as a hex dump of the given bytes (copied at the call)
+  struct Bytes { const uint8_t* data; size_t len; };
+
+  template <typename T>
+  static Hex hex(T value) { return Hex{static_cast<uint64_t>(value)}; }
+  static Bytes bytes(const uint8_t* data, size_t len) { return Bytes{data, len}; }
+
+private:
+  enum class Tag : uint8_t { INT = 1, UINT, REAL, HEX, TEXT, BYTES };
+
+  struct Record {
+    const char* format;
+    int64_t time_us;
+    LogLevel level;
+    bool truncated;
+    uint16_t size;
+    uint8_t args[RECORD_SIZE - 2 * sizeof(int64_t) - 2 * sizeof(uint16_t)];
+  };
+
+  // Single-producer/single-consumer ring of one logging thread
+  struct ThreadBuffer {
+    std::unique_ptr<Record[]> records{new Record[RING_CAPACITY]};
+    alignas(64) std::atomic<uint64_t> head{0};   // written by the logging thread
+    alignas(64) std::atomic<uint64_t> tail{0};   // written by the flusher
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<bool> retired{false};            // the thread has exited
+  };
+
+  // Attaches the calling thread's ring on its first record and retires it
+  // when the thread exits; the flusher drains it before letting it go
+  struct ThreadHolder {
+    std::shared_ptr<ThreadBuffer> buffer;
+    explicit ThreadHolder(Logger& logger) : buffer(std::make_shared<ThreadBuffer>()) {
+      logger.attach(buffer);
+    }
+    ~ThreadHolder() { buffer->retired.store(true, std::memory_order_release); }
+  };
+
+  // Bounded writer of the binary arguments of a record
+  struct ArgWriter {
+    uint8_t* pos;
+    uint8_t* end;
+    bool truncated;
+
+    void put(Tag tag, const void* data, size_t len) {
+      if (static_cast<size_t>(end - pos) < 1 + len) { truncated = true; return; }
+      *pos++ = static_cast<uint8_t>(tag);
+      memcpy(pos, data, len);
+      pos += len;
+    }
+
+    // Variable length data is stored with a 16-bit length and cut to fit
+    void putVar(Tag tag, const void* data, size_t len) {
+      if (static_cast<size_t>(end - pos) < 3) { truncated = true; return; }
+      size_t room = static_cast<size_t>(end - pos) - 3;
+      if (len > room) { len = room; truncated = true; }
+      uint16_t len16 = static_cast<uint16_t>(len);
+      *pos++ = static_cast<uint8_t>(tag);
+      memcpy(pos, &len16, sizeof(len16));
+      pos += sizeof(len16);
+      memcpy(pos, data, len);
+      pos += len;
+    }
+  };
+
+  std::atomic<uint8_t> level_;
+  std::ostream* sink_;
+  const std::chrono::steady_clock::time_point start_;
+
+  std::mutex registryMutex_;
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers_;
+
+  std::mutex drainMutex_;      // one consumer at a time
+  uint64_t droppedTotal_;
+
+  std::mutex wakeMutex_;
+  std::condition_variable wakeCv_;
+  std::atomic<bool> sleeping_;
+  bool wake_;
+  bool stop_;
+  std::thread flusher_;
+
+  Logger() : level_(0), sink_(&std::cout), start_(std::chrono::steady_clock::now()),
+             droppedTotal_(0), sleeping_(false), wake_(false), stop_(false) {
+    flusher_ = std::thread([this]() { run(); });
+  }
+
+public:
+  // The records still queued are written out before the flusher exits
+  ~Logger() {
+    {
+      std::lock_guard<std::mutex> lock(wakeMutex_);
+      stop_ = true;
+    }
+    wakeCv_.notify_one();
+    flusher_.join();
+    drain();
+  }
+
+  static Logger& instance() {
+    static Logger logger;
+    return logger;
+  }
+
+  // Lowest level written at run time, on top of LOG_MIN_LEVEL
+  void setLevel(LogLevel level) { level_.store(static_cast<uint8_t>(level), std::memory_order_relaxed); }
+  bool enabled(LogLevel level) const { return static_cast<uint8_t>(level) >= level_.load(std::memory_order_relaxed); }
+
+  // Stream the formatted records are written to (std::cout by default)
+  void setSink(std::ostream& sink) {
+    std::lock_guard<std::mutex> lock(drainMutex_);
+    sink_ = &sink;
+  }
+
+  // Number of records dropped on full rings so far
+  uint64_t dropped() {
+    std::lock_guard<std::mutex> lock(drainMutex_);
+    return droppedTotal_;
+  }
+
+  // Writes out all records queued so far on the calling thread
+  void flush() {
+    drain();
+  }
+
+  // Stores a record into the calling thread's ring. The arguments are taken
+  // by value, so that static constants may be logged without a definition.
+  template <typename... Args>
+  void write(LogLevel level, const char* format, Args... args) {
+    ThreadBuffer& buffer = localBuffer();
+
+    uint64_t head = buffer.head.load(std::memory_order_relaxed);
+    if (head - buffer.tail.load(std::memory_order_acquire) >= RING_CAPACITY) {
+      buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+
+    Record& record = buffer.records[head & (RING_CAPACITY - 1)];
+    record.format = format;
+    record.time_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_).count();
+    record.level = level;
+    ArgWriter writer{record.args, record.args + sizeof(record.args), false};
+    int expand[] = {0, (encode(writer, args), 0)...};
+    (void)expand;
+    record.size = static_cast<uint16_t>(writer.pos - record.args);
+    record.truncated = writer.truncated;
+    buffer.head.store(head + 1, std::memory_order_release);
+
+    // Wake the flusher up if it has gone to sleep on empty rings
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping_.load(std::memory_order_relaxed)) {
+      {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        wake_ = true;
+      }
+      wakeCv_.notify_one();
+    }
+  }
+
+private:
+  template <typename T>
+  static typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type
+  encode(ArgWriter& writer, T value) {
+    int64_t v = value;
+    writer.put(Tag::INT, &v, sizeof(v));
+  }
+
+  template <typename T>
+  static typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value>::type
+  encode(ArgWriter& writer, T value) {
+    uint64_t v = value;
+    writer.put(Tag::UINT, &v, sizeof(v));
+  }
+
+  template <typename T>
+  static typename std::enable_if<std::is_enum<T>::value>::type
+  encode(ArgWriter& writer, T value) {
+    encode(writer, static_cast<typename std::underlying_type<T>::type>(value));
+  }
+
+  template <typename T>
+  static typename std::enable_if<std::is_floating_point<T>::value>::type
+  encode(ArgWriter& writer, T value) {
+    double v = value;
+    writer.put(Tag::REAL, &v, sizeof(v));
+  }
+
+  static void encode(ArgWriter& writer, const char* text) {
+    writer.putVar(Tag::TEXT, text, strlen(text));
+  }
+
+  static void encode(ArgWriter& writer, const std::string& text) {
+    writer.putVar(Tag::TEXT, text.data(), text.size());
+  }
+
+  static void encode(ArgWriter& writer, Hex hex) {
+    writer.put(Tag::HEX, &hex.value, sizeof(hex.value));
+  }
+
+  static void encode(ArgWriter& writer, Bytes bytes) {
+    writer.putVar(Tag::BYTES, bytes.data, bytes.len);
+  }
+
+
+  // Ring of the calling thread, shared by all log calls of the thread
+  ThreadBuffer& localBuffer() {
+    static thread_local ThreadHolder holder(*this);
+    return *holder.buffer;
+  }
+
+
+  void attach(std::shared_ptr<ThreadBuffer> buffer) {
+    std::lock_guard<std::mutex> lock(registryMutex_);
+    buffers_.push_back(std::move(buffer));
+  }
+
+
+  // Flusher thread: drains the rings, lingers while records keep coming and
+  // sleeps once all rings are empty
+  void run() {
+    const int64_t lingerMs = LINGER_MS;
+    std::unique_lock<std::mutex> lock(wakeMutex_);
+    while (!stop_) {
+      lock.unlock();
+      size_t written = drain();
+      lock.lock();
+      if (stop_) break;
+
+      if (written > 0) {
+        wakeCv_.wait_for(lock, std::chrono::milliseconds(lingerMs), [this]() { return stop_; });
+        continue;
+      }
+
+      sleeping_.store(true, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (!pending())
+        wakeCv_.wait(lock, [this]() { return stop_ || wake_; });
+      wake_ = false;
+      sleeping_.store(false, std::memory_order_relaxed);
+    }
+  }
+
+
+  // True if any ring holds a record
+  bool pending() {
+    std::lock_guard<std::mutex> lock(registryMutex_);
+    for (auto& buffer : buffers_)
+      if (buffer->head.load(std::memory_order_acquire) != buffer->tail.load(std::memory_order_relaxed))
+        return true;
+    return false;
+  }
+
+
+  // Formats and writes out the records queued so far, merged by their time
+  // stamps; returns their number
+  size_t drain() {
+    std::lock_guard<std::mutex> drainLock(drainMutex_);
+
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    {
+      std::lock_guard<std::mutex> lock(registryMutex_);
+      buffers = buffers_;
+    }
+
+    std::string out;
+    std::vector<uint64_t> ends(buffers.size());
+    for (size_t i = 0; i < buffers.size(); i++) {
+      ends[i] = buffers[i]->head.load(std::memory_order_acquire);
+      uint64_t dropped = buffers[i]->dropped.exchange(0, std::memory_order_relaxed);
+      if (dropped > 0) {
+        droppedTotal_ += dropped;
+        out += "W log: " + std::to_string(dropped) + " records dropped\n";
+      }
+    }
+
+    size_t written = 0;
+    while (1) {
+      ThreadBuffer* next = nullptr;
+      for (size_t i = 0; i < buffers.size(); i++) {
+        uint64_t tail = buffers[i]->tail.load(std::memory_order_relaxed);
+        if (tail == ends[i]) continue;
+        const Record& record = buffers[i]->records[tail & (RING_CAPACITY - 1)];
+        if (next == nullptr || record.time_us < next->records[next->tail.load(std::memory_order_relaxed) & (RING_CAPACITY - 1)].time_us) {
+          next = buffers[i].get();
+        }
+      }
+      if (next == nullptr) break;
+
+      uint64_t tail = next->tail.load(std::memory_order_relaxed);
+      format(out, next->records[tail & (RING_CAPACITY - 1)]);
+      next->tail.store(tail + 1, std::memory_order_release);
+      written++;
+    }
+
+    if (!out.empty()) {
+      *sink_ << out;
+      sink_->flush();
+    }
+
+    // Let go the rings of the exited threads once they are empty
+    {
+      std::lock_guard<std::mutex> lock(registryMutex_);
+      for (auto it = buffers_.begin(); it != buffers_.end(); ) {
+        ThreadBuffer& buffer = **it;
+        if (buffer.retired.load(std::memory_order_acquire) &&
+            buffer.head.load(std::memory_order_acquire) == buffer.tail.load(std::memory_order_relaxed)) {
+          droppedTotal_ += buffer.dropped.exchange(0, std::memory_order_relaxed);
+          it = buffers_.erase(it);
+        } else {
+          ++it;
+        }
+      }
+    }
+    return written;
+  }
+
+
+  // Appends one formatted line: "<seconds> <level> <message>"
+  static void format(std::string& out, const Record& record) {
+    static const char LEVELS[] = {'D', 'I', 'W', 'E'};
+    char text[64];
+    snprintf(text, sizeof(text), "%lld.%06lld %c ",
+             static_cast<long long>(record.time_us / 1000000), static_cast<long long>(record.time_us % 1000000),
+             LEVELS[static_cast<uint8_t>(record.level) & 3]);
+    out += text;
+
+    const uint8_t* arg = record.args;
+    const uint8_t* end = record.args + record.size;
+    for (const char* f = record.format; *f != '\0'; f++) {
+      if (f[0] == '{' && f[1] == '}' && arg < end) {
+        arg = formatArg(out, arg);
+        f++;
+      } else {
+        out += *f;
+      }
+    }
+    if (record.truncated) out += " [truncated]";
+    out += '\n';
+  }
+
+
+  // Appends one argument and returns the position of the next one
+  static const uint8_t* formatArg(std::string& out, const uint8_t* arg) {
+    char text[32];
+    Tag tag = static_cast<Tag>(*arg++);
+    switch (tag) {
+      case Tag::INT: {
+        int64_t v;
+        memcpy(&v, arg, sizeof(v));
+        snprintf(text, sizeof(text), "%lld", static_cast<long long>(v));
+        out += text;
+        return arg + sizeof(v);
+      }
+      case Tag::UINT:
+      case Tag::HEX: {
+        uint64_t v;
+        memcpy(&v, arg, sizeof(v));
+        snprintf(text, sizeof(text), (tag == Tag::HEX) ? "%llx" : "%llu", static_cast<unsigned long long>(v));
+        out += text;
+        return arg + sizeof(v);
+      }
+      case Tag::REAL: {
+        double v;
+        memcpy(&v, arg, sizeof(v));
+        snprintf(text, sizeof(text), "%g", v);
+        out += text;
+        return arg + sizeof(v);
+      }
+      case Tag::TEXT:
+      case Tag::BYTES: {
+        uint16_t len;
+        memcpy(&len, arg, sizeof(len));
+        arg += sizeof(len);
+        if (tag == Tag::TEXT) {
+          out.append(reinterpret_cast<const char*>(arg), len);
+        } else {
+          for (uint16_t i = 0; i < len; i++) {
+            snprintf(text, sizeof(text), (i == 0) ? "%02x" : " %02x", arg[i]);
+            out += text;
+          }
+        }
+        return arg + len;
+      }
+    }
+    return arg;
+  }
+};
+
+
+
+// Logging macros. The arguments of a record below LOG_MIN_LEVEL are not even
+// evaluated.
+#define LOG_AT(level, ...) \
+  do { if (Logger::instance().enabled(level)) Logger::instance().write(level, __VA_ARGS__); } while (0)
+
+#if LOG_MIN_LEVEL <= 0
+#define LOG_DEBUG(...) LOG_AT(LogLevel::DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) do { } while (0)
+#endif
+
+#if LOG_MIN_LEVEL <= 1
+#define LOG_INFO(...) LOG_AT(LogLevel::INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) do { } while (0)
+#endif
+
+#if LOG_MIN_LEVEL <= 2
+#define LOG_WARN(...) LOG_AT(LogLevel::WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) do { } while (0)
+#endif
+
+#define LOG_ERROR(...) LOG_AT(LogLevel::ERR, __VA_ARGS__)
+
+
+#endif /* D_LOGGER_H */
@@ -0,0 +1,347 @@
+/*
+ * @file   LoopbackTransport.h
+ * @author Armin Zare Zadeh, ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   In-process loopback transport. Simulated requester nodes are
+ *          connected to the protocol handler through lock-free byte pipes
+ *          instead of sockets, so that tests and simulations drive the
+ *          whole protocol and controller stack in one process, without
+ *          ports and at memory speed.
+ */
+
+#ifndef D_LOOPBACK_TRANSPORT_H
+#define D_LOOPBACK_TRANSPORT_H
+
+#include "Transport.h"
+#include "ByteRing.h"
+#include "MpscRing.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+
+namespace Net {
+
+// Byte pipe between one producer and one consumer thread, with free running
+// positions on separate cache lines. A write appends all of its bytes or
+// none of them, so a frame never arrives in part.
+class BytePipe : noncopyable {
+private:
+  std::unique_ptr<uint8_t[]> data_;
+  const size_t mask_;
+
+  alignas(64) std::atomic<size_t> tail_;
+  alignas(64) std::atomic<size_t> head_;
+
+public:
+  // ctor; the capacity must be a power of two
+  explicit BytePipe(size_t capacity) : data_(new uint8_t[capacity]), mask_(capacity - 1), tail_(0), head_(0) {
+    if (capacity < 2 || (capacity & (capacity - 1)) != 0)
+      throw std::invalid_argument("Pipe capacity is not a power of two: " + std::to_string(capacity));
+  }
+
+  size_t capacity() const { return mask_ + 1; }
+
+  // Number of buffered bytes
+  size_t size() const {
+    return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+  }
+
+  // Producer side: appends the bytes. Returns false if they do not fit.
+  bool write(const uint8_t* data, size_t len) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (capacity() - (tail - head_.load(std::memory_order_acquire)) < len)
+      return false;
+    size_t pos = tail & mask_;
+    size_t first = std::min(len, capacity() - pos);
+    memcpy(&data_[pos], data, first);
+    memcpy(&data_[0], data + first, len - first);
+    tail_.store(tail + len, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side: moves up to len bytes out and returns their number
+  size_t read(uint8_t* dst, size_t len) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    size_t num = std::min(len, tail_.load(std::memory_order_acquire) - head);
+    size_t pos = head & mask_;
+    size_t first = std::min(num, capacity() - pos);
+    memcpy(dst, &data_[pos], first);
+    memcpy(dst + first, &data_[0], num - first);
+    head_.store(head + num, std::memory_order_release);
+    return num;
+  }
+};
+
+
+
+// Transport of in-process connections. Every connection is a pair of byte
+// pipes: the requester end (a Peer) writes its frames into the one and reads
+// the replies from the other. A connection with new bytes is queued once on
+// a lock-free ready ring, and its read handler is called by poll(), which
+// either the listening thread runs, or the owner of the transport on its
+// own thread, e.g. from the events of a discrete-event simulation. The
+// handlers of a connection thus run in the order in which the requesters
+// have sent, and a single-threaded driver replays the same traffic
+// exactly. Unlike a socket, the accept handler runs on the connecting
+// thread and the close handler on the polling one.
+class LoopbackTransport : public Transport {
+private:
+  // Controller end of a connection, which owns both pipes
+  class Link : public Connection, public std::enable_shared_from_this<Link> {
+  public:
+    Link(int id, LoopbackTransport& transport, size_t pipeBytes) :
+        id_(id), transport_(transport), up_(pipeBytes), down_(pipeBytes), rx_(pipeBytes),
+        scheduled_(false), closed_(false), txDropped_(0) {}
+
+    int fileDescriptor() const override { return id_; }
+
+    void close() override {
+      if (!closed_.exchange(true, std::memory_order_acq_rel))
+        transport_.schedule(shared_from_this());
+    }
+
+    // A frame which does not fit into the pipe is lost, whether it is
+    // droppable or not, just like on the full send queue of a socket.
+    // Frames may be written from any thread.
+    void write(const uint8_t* data, size_t len, bool droppable = false) override {
+      (void)droppable;
+      std::lock_guard<std::mutex> lock(txMutex_);
+      if (closed_.load(std::memory_order_relaxed))
+        return;
+      if (!down_.write(data, len))
+        txDropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void write(std::shared_ptr<const std::vector<uint8_t>> shared, bool droppable = false) override {
+      write(shared->data(), shared->size(), droppable);
+    }
+
+    bool receive() override {
+      while (true) {
+        size_t len = 0;
+        uint8_t* buffer = rx_.writePtr(len);
+        if (len == 0)
+          return up_.size() == 0;
+        size_t num = up_.read(buffer, len);
+        if (num == 0)
+          return true;
+        rx_.commit(num);
+      }
+    }
+
+    ByteRing& rxBuffer() override { return rx_; }
+
+    const int id_;
+    LoopbackTransport& transport_;
+    BytePipe up_;     // requester -> controller
+    BytePipe down_;   // controller -> requester
+    ByteRing rx_;
+    std::mutex txMutex_;               // serializes the writers of down_
+    std::atomic<bool> scheduled_;      // queued on the ready ring
+    std::atomic<bool> closed_;
+    std::atomic<uint64_t> txDropped_;  // frames lost on a full pipe
+  };
+
+public:
+  // Requester end of a connection, e.g. a simulated hall panel or lobby
+  // display. It is a handle which may be copied; its sending side is used
+  // by one thread at a time, and so is its receiving side.
+  class Peer {
+  public:
+    // Number of the connection on the controller side
+    int fileDescriptor() const { return link_->id_; }
+
+    // Sends the bytes to the controller. Returns false if the connection
+    // has been closed or the pipe is full.
+    bool send(const uint8_t* data, size_t len) {
+      if (link_->closed_.load(std::memory_order_acquire) || !link_->up_.write(data, len))
+        return false;
+      link_->transport_.schedule(link_);
+      return true;
+    }
+
+    bool send(const std::vector<uint8_t>& data) { return send(data.data(), data.size()); }
+
+    // Moves up to len bytes received from the controller out and returns
+    // their number
+    size_t receive(uint8_t* buffer, size_t len) { return link_->down_.read(buffer, len); }
+
+    // Number of bytes received from the controller and not read yet
+    size_t pending() const { return link_->down_.size(); }
+
+    // Number of frames the controller has lost on the full pipe
+    uint64_t dropped() const { return link_->txDropped_.load(std::memory_order_relaxed); }
+
+    bool closed() const { return link_->closed_.load(std::memory_order_acquire); }
+
+    // Closes the connection; the close handler runs on the next poll
+    void close() { link_->close(); }
+
+  private:
+    friend class LoopbackTransport;
+    explicit Peer(std::shared_ptr<Link> link) : link_(std::move(link)) {}
+
+    std::shared_ptr<Link> link_;
+  };
+
+  static const size_t DEFAULT_MAX_CONNECTIONS = 1024;
+  static const size_t DEFAULT_PIPE_BYTES = 512;   // per direction, a power of two
+
+  // ctor; the pipe size must hold the frames in flight on a connection
+  explicit LoopbackTransport(size_t maxConnections = DEFAULT_MAX_CONNECTIONS, size_t pipeBytes = DEFAULT_PIPE_BYTES) :
+      maxConnections_(maxConnections),
+      pipeBytes_(pipeBytes),
+      ready_(ringCapacity(2 * maxConnections)),
+      nextId_(1),
+      parked_(false),
+      interrupted_(false) {}
+
+  // dtor; the open connections are closed without calling the handlers
+  ~LoopbackTransport() {
+    std::lock_guard<std::mutex> lock(connectionsMutex_);
+    for (auto& connection : connections_)
+      connection.second->closed_.store(true, std::memory_order_release);
+  }
+
+  void onAccept(Handler handler) override { handleAccept_ = std::move(handler); }
+  void onRead(Handler handler) override { handleRead_ = std::move(handler); }
+  void onClose(Handler handler) override { handleClose_ = std::move(handler); }
+
+  // Opens a new connection and calls the accept handler for it
+  Peer connect() {
+    std::shared_ptr<Link> link;
+    {
+      std::lock_guard<std::mutex> lock(connectionsMutex_);
+      if (connections_.size() >= maxConnections_)
+        throw std::runtime_error("Too many loopback connections: " + std::to_string(maxConnections_));
+      link = std::make_shared<Link>(nextId_++, *this, pipeBytes_);
+      connections_[link->id_] = link;
+    }
+    dispatch(handleAccept_, link);
+    return Peer(link);
+  }
+
+  // Number of open connections
+  size_t size() {
+    std::lock_guard<std::mutex> lock(connectionsMutex_);
+    return connections_.size();
+  }
+
+  // Calls the read handler of every connection with new bytes, and the
+  // close handler of every closed one, on the calling thread. Only one
+  // thread may poll at a time. Returns the number of handled connections.
+  size_t poll() {
+    return ready_.consume_all([this](std::shared_ptr<Link>&& link) {
+      // Bytes sent from now on queue the connection again
+      link->scheduled_.exchange(false, std::memory_order_acq_rel);
+      if (link->closed_.load(std::memory_order_acquire)) {
+        {
+          std::lock_guard<std::mutex> lock(connectionsMutex_);
+          if (connections_.erase(link->id_) == 0)
+            return;
+        }
+        dispatch(handleClose_, link);
+      } else {
+        dispatch(handleRead_, link);
+      }
+    });
+  }
+
+  // Polls the connections until the stop request holds; the thread sleeps
+  // while no connection has new bytes
+  void listen(std::function<bool ()> stopRequested) override {
+    LOG_INFO("Loopback Transport Listening starts...");
+    while (!stopRequested()) {
+      poll();
+
+      std::unique_lock<std::mutex> lock(waitMutex_);
+      parked_.store(true, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      waitCv_.wait(lock, [&]() -> bool { return interrupted_ || !ready_.empty() || stopRequested(); });
+      parked_.store(false, std::memory_order_relaxed);
+      interrupted_ = false;
+    }
+    LOG_INFO("Loopback Transport Listening exits.");
+  }
+
+  void interrupt() override {
+    std::lock_guard<std::mutex> lock(waitMutex_);
+    interrupted_ = true;
+    waitCv_.notify_one();
+  }
+
+private:
+  // Smallest power of two which holds the given number of entries. The
+  // ready ring gets room for two entries per connection: a closed link which
+  // poll() has erased may still be queued again by a racing send.
+  static size_t ringCapacity(size_t entries) {
+    size_t capacity = 2;
+    while (capacity < entries) capacity <<= 1;
+    return capacity;
+  }
+
+  // Queues the connection for the next poll, unless it is queued already.
+  // The listening thread is only woken up when it sleeps.
+  void schedule(const std::shared_ptr<Link>& link) {
+    if (link->scheduled_.exchange(true, std::memory_order_acq_rel))
+      return;
+    if (!ready_.try_push(link)) {
+      // The next send queues the connection again
+      link->scheduled_.store(false, std::memory_order_release);
+      LOG_ERROR("Loopback Transport ready queue is full; connection {} is not polled", link->id_);
+      return;
+    }
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (parked_.load(std::memory_order_relaxed)) {
+      std::lock_guard<std::mutex> lock(waitMutex_);
+      waitCv_.notify_one();
+    }
+  }
+
+  // Runs a handler for the connection; a failing handler only drops the event
+  void dispatch(const Handler& handler, const std::shared_ptr<Link>& link) {
+    if (!handler)
+      return;
+    try {
+      handler(link);
+    } catch (const std::exception& e) {
+      LOG_ERROR("Loopback Transport handler failed: {}", e.what());
+    }
+  }
+
+  const size_t maxConnections_;
+  const size_t pipeBytes_;
+
+  // Connections waiting for their handlers
+  MpscRing<std::shared_ptr<Link>> ready_;
+
+  // Open connections indexed by their number
+  std::mutex connectionsMutex_;
+  std::unordered_map<int, std::shared_ptr<Link>> connections_;
+  int nextId_;
+
+  Handler handleAccept_;
+  Handler handleRead_;
+  Handler handleClose_;
+
+  // Sleep of the listening thread
+  std::mutex waitMutex_;
+  std::condition_variable waitCv_;
+  std::atomic<bool> parked_;
+  bool interrupted_;
+};
+
+}
+
+#endif /* D_LOOPBACK_TRANSPORT_H */
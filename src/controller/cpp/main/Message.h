@@ -0,0 +1,55 @@
+/*
+ * @file   Message.h
+ * @author Armin Zare Zadeh, ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   Messages exchanged between the network protocol handler and
+ *          the elevator's controller: the commands of the requester nodes
+ *          and the status reports of the cars.
+ */
+
+#ifndef D_ELEVATOR_MESSAGE_H
+#define D_ELEVATOR_MESSAGE_H
+
+#include "Request.h"
+
+#include <type_traits>
+#include <cstdint>
+
+
+
+// State of a car whether moving or stopped
+enum class CarState : uint8_t { MOVING = 1, STOPPED };
+
+
+// Command of a requester node, as decoded from a request frame. It is small
+// and trivially copyable; the parser emits it from the stack and the
+// scheduler copies it once into its ingress ring.
+struct CarCommand {
+  uint16_t node_addr;            // Requester Node Address
+  uint16_t msg_id;               // Network Message ID
+  Request::Command cmd;          // Command
+  uint8_t floor;                 // floor number; the car index of a QUERY
+  Request::Direction direction;  // direction of a CALL
+};
+
+
+// Status report of a car. A report answering a request carries the
+// requester's node address and message ID; a published status change is
+// addressed to all subscribers. Queued connections copy it by value into
+// their mailbox.
+struct CarStatus {
+  uint16_t node_addr;            // Requester Node Address
+  uint16_t msg_id;               // Network Message ID
+  uint8_t car_id;                // Index of the car in its group
+  uint8_t floor;                 // Location of the car
+  CarState state;                // Moving or stopped
+  Request::Direction direction;  // Direction of moving
+};
+
+
+static_assert(std::is_trivially_copyable<CarCommand>::value && sizeof(CarCommand) <= 8, "CarCommand must stay a small plain value");
+static_assert(std::is_trivially_copyable<CarStatus>::value && sizeof(CarStatus) <= 8, "CarStatus must stay a small plain value");
+
+
+#endif /* D_ELEVATOR_MESSAGE_H */
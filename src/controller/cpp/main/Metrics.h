@@ -0,0 +1,222 @@
+/*
+ * @file   Metrics.h
+ * @author Armin Zare Zadeh, ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   Registry of the runtime metrics of the elevator system:
+ *          counters, gauges and timing summaries which are updated
+ *          lock-free by the working threads and rendered as Prometheus
+ *          text by the exporter.
+ */
+
+#ifndef D_METRICS_H
+#define D_METRICS_H
+
+#include "NonCopyable.h"
+#include "LatencyHistogram.h"
+
+#include <atomic>
+#include <cstdint>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+
+// Monotonic counter updated by many threads. Every thread adds to a shard
+// of its own (on its own cache line), so the hot paths never contend; the
+// value is the sum of the shards.
+class Counter : noncopyable {
+public:
+  static const size_t SHARDS = ShardedHistogram::SHARDS;
+
+private:
+  struct Shard {
+    std::atomic<uint64_t> value;
+    char pad[64 - sizeof(std::atomic<uint64_t>)];
+  };
+  Shard shards_[SHARDS];
+
+public:
+  // ctor
+  Counter() {
+    for (auto& shard : shards_) shard.value.store(0, std::memory_order_relaxed);
+  }
+
+  void add(uint64_t n = 1) {
+    shards_[ShardedHistogram::threadIndex() % SHARDS].value.fetch_add(n, std::memory_order_relaxed);
+  }
+
+  uint64_t value() const {
+    uint64_t sum = 0;
+    for (auto& shard : shards_) sum += shard.value.load(std::memory_order_relaxed);
+    return sum;
+  }
+};
+
+
+
+// Gauge holding the last value set by its owner, e.g. a queue depth which
+// is sampled by the thread owning the queue
+class Gauge : noncopyable {
+private:
+  std::atomic<int64_t> value_;
+
+public:
+  // ctor
+  Gauge() : value_(0) {}
+
+  void set(int64_t value) { value_.store(value, std::memory_order_relaxed); }
+  void add(int64_t n) { value_.fetch_add(n, std::memory_order_relaxed); }
+  int64_t value() const { return value_.load(std::memory_order_relaxed); }
+};
+
+
+
+// Named metrics of the process. A metric is registered once by its owner,
+// which keeps the returned pointer and updates the metric directly; the
+// registry only holds weak references, so the metrics of destroyed objects
+// disappear from the export. Registering a metric which is alive already
+// returns the same instance. Only registration and export take the lock.
+//
+// Names follow the Prometheus conventions; the labels of a series are
+// given in their text form, e.g. car="0",kind="up".
+class MetricsRegistry : noncopyable {
+public:
+  enum class Type : uint8_t { COUNTER = 0, GAUGE, SUMMARY };
+
+private:
+  struct Series {
+    std::string labels;
+    std::weak_ptr<void> metric;
+  };
+
+  struct Family {
+    std::string help;
+    Type type;
+    double scale;   // unit of a summary's values in seconds
+    std::vector<Series> series;
+  };
+
+  mutable std::mutex mutex_;
+  std::map<std::string, Family> families_;
+
+public:
+  // Registry which the system's metrics are registered with
+  static MetricsRegistry& instance() {
+    static MetricsRegistry registry;
+    return registry;
+  }
+
+  std::shared_ptr<Counter> counter(const std::string& name, const std::string& help, const std::string& labels = "") {
+    return get<Counter>(name, help, labels, Type::COUNTER, 1.0);
+  }
+
+  std::shared_ptr<Gauge> gauge(const std::string& name, const std::string& help, const std::string& labels = "") {
+    return get<Gauge>(name, help, labels, Type::GAUGE, 1.0);
+  }
+
+  // Timing summary; the values are recorded in units of the given number of
+  // seconds (e.g. 1e-9 for nanoseconds) and exported in seconds
+  std::shared_ptr<LatencyHistogram> summary(const std::string& name, const std::string& help, const std::string& labels = "", double scale = 1e-9) {
+    return get<LatencyHistogram>(name, help, labels, Type::SUMMARY, scale);
+  }
+
+  // Renders all live metrics in the Prometheus text exposition format
+  void write(std::ostream& out) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    out << std::setprecision(9);
+    for (const auto& family : families_) {
+      const std::string& name = family.first;
+      bool header = false;
+      for (const auto& series : family.second.series) {
+        std::shared_ptr<void> metric = series.metric.lock();
+        if (!metric) continue;
+        if (!header) {
+          out << "# HELP " << name << " " << family.second.help << "\n";
+          out << "# TYPE " << name << " " << typeName(family.second.type) << "\n";
+          header = true;
+        }
+        writeSeries(out, name, family.second, series.labels, metric.get());
+      }
+    }
+  }
+
+  std::string text() const {
+    std::ostringstream out;
+    write(out);
+    return out.str();
+  }
+
+private:
+  template <typename T>
+  std::shared_ptr<T> get(const std::string& name, const std::string& help, const std::string& labels, Type type, double scale) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = families_.find(name);
+    if (it == families_.end())
+      it = families_.insert(std::make_pair(name, Family{help, type, scale, {}})).first;
+    else if (it->second.type != type)
+      throw std::invalid_argument("Metric registered with another type: " + name);
+
+    // Drop the series of destroyed owners, reuse a live one
+    auto& series = it->second.series;
+    for (auto s = series.begin(); s != series.end();) {
+      if (s->metric.expired()) {
+        s = series.erase(s);
+      } else if (s->labels == labels) {
+        return std::static_pointer_cast<T>(s->metric.lock());
+      } else {
+        ++s;
+      }
+    }
+    auto metric = std::make_shared<T>();
+    series.push_back(Series{labels, metric});
+    return metric;
+  }
+
+  static const char* typeName(Type type) {
+    switch (type) {
+      case Type::COUNTER: return "counter";
+      case Type::GAUGE: return "gauge";
+      default: return "summary";
+    }
+  }
+
+  // Label set in braces, with an extra label appended; empty if there are
+  // no labels at all
+  static std::string braces(const std::string& labels, const std::string& extra = "") {
+    if (labels.empty() && extra.empty()) return "";
+    if (labels.empty() || extra.empty()) return "{" + labels + extra + "}";
+    return "{" + labels + "," + extra + "}";
+  }
+
+  static void writeSeries(std::ostream& out, const std::string& name, const Family& family, const std::string& labels, void* metric) {
+    switch (family.type) {
+      case Type::COUNTER:
+        out << name << braces(labels) << " " << static_cast<Counter*>(metric)->value() << "\n";
+        break;
+      case Type::GAUGE:
+        out << name << braces(labels) << " " << static_cast<Gauge*>(metric)->value() << "\n";
+        break;
+      case Type::SUMMARY: {
+        const LatencyHistogram& h = *static_cast<LatencyHistogram*>(metric);
+        const char* quantiles[] = {"0.5", "0.9", "0.99"};
+        const double percents[] = {50, 90, 99};
+        for (size_t i = 0; i < 3; i++)
+          out << name << braces(labels, std::string("quantile=\"") + quantiles[i] + "\"") << " "
+              << static_cast<double>(h.percentile(percents[i])) * family.scale << "\n";
+        out << name << "_sum" << braces(labels) << " " << static_cast<double>(h.sum()) * family.scale << "\n";
+        out << name << "_count" << braces(labels) << " " << h.count() << "\n";
+        break;
+      }
+    }
+  }
+};
+
+
+#endif /* D_METRICS_H */
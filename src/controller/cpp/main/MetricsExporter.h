@@ -0,0 +1,280 @@
+/*
+ * @file   MetricsExporter.h
+ * @author Armin Zare Zadeh, ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   Exporter of the metrics registry: Prometheus text served over
+ *          HTTP on a local port, and the same text published to a shared
+ *          memory page for local tools which do not speak HTTP.
+ */
+
+#ifndef D_METRICS_EXPORTER_H
+#define D_METRICS_EXPORTER_H
+
+#include "StoppableTask.h"
+#include "Metrics.h"
+#include "TransportSocket.h"
+#include "Logger.h"
+
+#ifndef __WIN32__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace Net {
+
+#ifndef __WIN32__
+
+// POSIX shared memory page holding the latest Prometheus text. The page is
+// written by one process and read by any number of others. The writer makes
+// the sequence number odd, copies the text and makes it even again; a
+// reader retries while the number is odd or has changed during its copy,
+// so a reader never blocks the writer.
+class MetricsPage : noncopyable {
+public:
+  static const uint32_t MAGIC = 0x4D544C45;   // "ELTM"
+  static const size_t PAGE_BYTES = 64 * 1024;
+
+  struct Header {
+    uint32_t magic;
+    std::atomic<uint32_t> seq;
+    std::atomic<uint32_t> length;   // bytes of text following the header
+    std::atomic<int64_t> timeMs;    // wall clock time of the last update
+  };
+
+  static const size_t TEXT_BYTES = PAGE_BYTES - sizeof(Header);
+
+private:
+  std::string name_;
+  int fd_;
+  Header* header_;
+
+public:
+  // ctor; creates the page with the given name, e.g. "/elevator_metrics"
+  explicit MetricsPage(const std::string& name) : name_(name), fd_(-1), header_(nullptr) {
+    fd_ = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+    if (fd_ == -1)
+      throw std::runtime_error("shm_open " + name + ": " + strerror(errno));
+    if (ftruncate(fd_, PAGE_BYTES) == -1 ||
+        (header_ = static_cast<Header*>(mmap(nullptr, PAGE_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0))) == MAP_FAILED) {
+      std::string error = strerror(errno);
+      ::close(fd_);
+      shm_unlink(name.c_str());
+      throw std::runtime_error("Metrics page " + name + ": " + error);
+    }
+    header_->seq.store(0, std::memory_order_relaxed);
+    header_->length.store(0, std::memory_order_relaxed);
+    header_->timeMs.store(0, std::memory_order_relaxed);
+    header_->magic = MAGIC;
+  }
+
+  // dtor; the page is removed together with its writer
+  ~MetricsPage() {
+    munmap(header_, PAGE_BYTES);
+    ::close(fd_);
+    shm_unlink(name_.c_str());
+  }
+
+  // Writer side. A text longer than the page is cut after its last line
+  // which fits.
+  void publish(const std::string& text, int64_t timeMs) {
+    size_t len = text.size();
+    if (len > TEXT_BYTES) {
+      size_t end = text.rfind('\n', TEXT_BYTES - 1);
+      len = (end == std::string::npos) ? 0 : end + 1;
+    }
+
+    uint32_t seq = header_->seq.load(std::memory_order_relaxed);
+    header_->seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(reinterpret_cast<char*>(header_ + 1), text.data(), len);
+    header_->length.store(static_cast<uint32_t>(len), std::memory_order_relaxed);
+    header_->timeMs.store(timeMs, std::memory_order_relaxed);
+    header_->seq.store(seq + 2, std::memory_order_release);
+  }
+
+  // Reader side: consistent copy of the text of the page with the given
+  // name; throws if there is no such page
+  static std::string read(const std::string& name) {
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd == -1)
+      throw std::runtime_error("shm_open " + name + ": " + strerror(errno));
+    void* page = mmap(nullptr, PAGE_BYTES, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (page == MAP_FAILED)
+      throw std::runtime_error("Metrics page " + name + ": " + strerror(errno));
+
+    const Header* header = static_cast<const Header*>(page);
+    std::string text;
+    uint32_t before, after;
+    do {
+      before = header->seq.load(std::memory_order_acquire);
+      size_t len = std::min<size_t>(header->length.load(std::memory_order_relaxed), TEXT_BYTES);
+      text.assign(reinterpret_cast<const char*>(header + 1), len);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      after = header->seq.load(std::memory_order_relaxed);
+    } while ((before & 1) != 0 || before != after);
+
+    bool valid = header->magic == MAGIC;
+    munmap(page, PAGE_BYTES);
+    if (!valid)
+      throw std::runtime_error("Not a metrics page: " + name);
+    return text;
+  }
+};
+
+#endif
+
+
+// Metrics exporter task which is derived from the stoppable thread for easy
+// stopping. Its thread serves "GET /metrics" on a local HTTP port through
+// its own transport socket, and a second thread refreshes the shared memory
+// page periodically. Both only read the registry; the threads updating the
+// metrics are never locked.
+class MetricsExporter : public Stoppable {
+public:
+  static const int METRICS_PORT = 9102;
+  static const int64_t PUBLISH_MS = 1000;
+  static const size_t MAX_REQUEST_BYTES = 2048;
+
+private:
+  MetricsRegistry& registry_;
+  std::unique_ptr<TransportSocket> transportSocket_;
+  std::string pageName_;
+
+  // Wakes the page publisher up on a stop request
+  std::mutex publishMutex_;
+  std::condition_variable publishCv_;
+
+public:
+  // ctor; an empty page name disables the shared memory page
+  MetricsExporter(int port = METRICS_PORT, const std::string& pageName = "/elevator_metrics",
+                  MetricsRegistry& registry = MetricsRegistry::instance()) :
+      registry_(registry),
+      transportSocket_(new TransportSocket(port)),
+      pageName_(pageName) {
+    transportSocket_->setLocalOnly(true);
+    onStop([this]() {
+      transportSocket_->interrupt();
+      std::lock_guard<std::mutex> lock(publishMutex_);
+      publishCv_.notify_all();
+    });
+  }
+
+
+  // dtor
+  ~MetricsExporter() {
+    transportSocket_ = nullptr;
+  }
+
+
+  // Thread loop method
+  void run() {
+    LOG_INFO("Metrics exporter starting...");
+    std::thread publisher([this]() { publishPage(); });
+
+    transportSocket_->onRead([this](std::weak_ptr<Connection> socket) {
+      if (auto s = socket.lock())
+        serve(*s);
+    });
+    // Without its port the exporter keeps publishing the page
+    try {
+      transportSocket_->listen([this]() -> bool { return stopRequested(); });
+    } catch (const std::exception& e) {
+      LOG_ERROR("Metrics port disabled: {}", e.what());
+    }
+
+    publisher.join();
+    LOG_INFO("Metrics exporter exits.");
+  }
+
+private:
+  // Answers the complete HTTP requests in the receive buffer of a
+  // connection. The connection is kept open for the next scrape.
+  void serve(Connection& s) {
+    bool drained;
+    do {
+      drained = s.receive();
+      ByteRing& rx = s.rxBuffer();
+
+      size_t end;
+      while ((end = requestEnd(rx)) != 0) {
+        std::string request(end, '\0');
+        rx.copyOut(0, reinterpret_cast<uint8_t*>(&request[0]), end);
+        rx.consume(end);
+
+        if (request.compare(0, 13, "GET /metrics ") == 0)
+          respond(s, "200 OK", registry_.text());
+        else
+          respond(s, "404 Not Found", "Not found\n");
+      }
+
+      // Not a scrape request
+      if (rx.size() > MAX_REQUEST_BYTES) {
+        s.close();
+        return;
+      }
+    } while (!drained);
+  }
+
+
+  // Length of the first complete request (up to its blank line) in the
+  // buffer, or 0 if there is none yet
+  static size_t requestEnd(const ByteRing& rx) {
+    for (size_t i = 3; i < rx.size(); i++)
+      if (rx.at(i) == '\n' && rx.at(i - 1) == '\r' && rx.at(i - 2) == '\n' && rx.at(i - 3) == '\r')
+        return i + 1;
+    return 0;
+  }
+
+
+  static void respond(Connection& s, const char* status, const std::string& body) {
+    std::string response = std::string("HTTP/1.1 ") + status + "\r\n"
+                           "Content-Type: text/plain; version=0.0.4\r\n"
+                           "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+    s.write(std::make_shared<const std::vector<uint8_t>>(response.begin(), response.end()));
+  }
+
+
+  // Publisher thread: refreshes the shared memory page until a stop request
+  void publishPage() {
+#ifndef __WIN32__
+    if (pageName_.empty()) return;
+
+    std::unique_ptr<MetricsPage> page;
+    try {
+      page.reset(new MetricsPage(pageName_));
+    } catch (const std::exception& e) {
+      LOG_ERROR("Metrics page disabled: {}", e.what());
+      return;
+    }
+
+    std::unique_lock<std::mutex> lock(publishMutex_);
+    while (!stopRequested()) {
+      lock.unlock();
+      int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+      page->publish(registry_.text(), now);
+      lock.lock();
+      int64_t periodMs = PUBLISH_MS;
+      publishCv_.wait_for(lock, std::chrono::milliseconds(periodMs), [this]() { return stopRequested(); });
+    }
+#endif
+  }
+};
+
+}
+
+#endif /* D_METRICS_EXPORTER_H */
@@ -0,0 +1,119 @@
+/*
+ * @file   MpscRing.h
+ * @author Armin Zare Zadeh, ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   Bounded lock-free multi-producer/single-consumer ring buffer.
+ *          It is being used for handing over the incoming requests from
+ *          the network threads to the controller's process thread.
+ */
+
+#ifndef D_MPSC_RING_H
+#define D_MPSC_RING_H
+
+#include "NonCopyable.h"
+
+#include <atomic>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <cstdint>
+
+
+
+// Bounded ring of slots with per-slot sequence numbers. Producers reserve a
+// slot with a single CAS on the tail and publish the element by bumping the
+// slot's sequence number; the consumer reads the slot once its sequence
+// number shows it has been published. Neither side ever takes a lock.
+template <typename T>
+class MpscRing : noncopyable {
+private:
+  struct Slot {
+    std::atomic<size_t> seq;
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+  };
+
+  std::unique_ptr<Slot[]> slots_;
+  const size_t mask_;
+
+  // Producers and consumer positions live on separate cache lines
+  alignas(64) std::atomic<size_t> tail_;
+  alignas(64) std::atomic<size_t> head_;
+
+public:
+  // ctor; the capacity must be a power of two
+  explicit MpscRing(size_t capacity) : slots_(new Slot[capacity]), mask_(capacity - 1), tail_(0), head_(0) {
+    if (capacity < 2 || (capacity & (capacity - 1)) != 0)
+      throw std::invalid_argument("Ring capacity is not a power of two: " + std::to_string(capacity));
+    for (size_t i = 0; i < capacity; i++)
+      slots_[i].seq.store(i, std::memory_order_relaxed);
+  }
+
+  // dtor
+  ~MpscRing() {
+    consume_all([](T&&) {});
+  }
+
+  size_t capacity() const { return mask_ + 1; }
+
+  // Number of queued elements. It is exact on the consumer side and an
+  // estimate for any other thread.
+  size_t size() const {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    size_t head = head_.load(std::memory_order_relaxed);
+    return (tail > head) ? tail - head : 0;
+  }
+
+  // Consumer side: true if no published element is waiting
+  bool empty() const {
+    size_t head = head_.load(std::memory_order_relaxed);
+    return slots_[head & mask_].seq.load(std::memory_order_acquire) != head + 1;
+  }
+
+  // Producer side: appends a copy of the element. Returns false if the
+  // ring is full.
+  bool try_push(const T& value) {
+    size_t pos = tail_.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+      slot = &slots_[pos & mask_];
+      size_t seq = slot->seq.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+          break;
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+    new (&slot->storage) T(value);
+    slot->seq.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side: hands every published element to f in FIFO order and
+  // returns the number of consumed elements
+  template <typename F>
+  size_t consume_all(F f) {
+    size_t count = 0;
+    size_t head = head_.load(std::memory_order_relaxed);
+    while (true) {
+      Slot& slot = slots_[head & mask_];
+      if (slot.seq.load(std::memory_order_acquire) != head + 1) break;
+      T* value = reinterpret_cast<T*>(&slot.storage);
+      f(std::move(*value));
+      value->~T();
+      slot.seq.store(head + mask_ + 1, std::memory_order_release);
+      head_.store(++head, std::memory_order_relaxed);
+      count++;
+    }
+    return count;
+  }
+};
+
+
+#endif /* D_MPSC_RING_H */
@@ -17,7 +17,12 @@
 #include "signal_slot.h"
 #include "NonCopyable.h"
 #include "Request.h"
+#include "Message.h"
 #include "TransportSocket.h"
+#include "Logger.h"
+#include "LatencyHistogram.h"
+#include "Metrics.h"
+#include "Trace.h"
 
 #include <Winsock.h>
 
@@ -34,7 +39,11 @@
 #include <functional>
 #include <memory>
 #include <mutex>
+#include <atomic>
+#include <chrono>
 #include <vector>
+#include <unordered_map>
+#include <cstddef>
 
 
 namespace Net {
@@ -42,49 +51,58 @@ namespace Net {
 static const uint16_t NODE_ADDRESS = 0x3E8;
 
 
-// CRC16-CCITT Implementation
+// CRC16-CCITT Implementation (reflected polynomial 0x8408, initial value
+// 0xFFFF, inverted and byte swapped result), the same as the crc16 of the
+// requester. It is table driven with slicing-by-8: eight bytes are folded
+// into the CRC per step through eight 256-entry tables, which are built
+// once on the first use.
 static const uint16_t POLY = 0x8408;
-uint16_t crc16(const std::vector<uint8_t>& data) {
-  uint16_t crc = 0xFFFF;
-  std::cout << std::endl;
-  for (auto b : data) {
-    std::cout << (b&0xff) << ":";
-    uint8_t cur_byte = 0xFF & b;
-    for (int i=0; i<8; i++) {
-      if ((crc & 0x0001) ^ (cur_byte & 0x0001))
-        crc = (crc >> 1) ^ POLY;
-      else
-        crc >>= 1;
-      cur_byte >>= 1;
+
+struct Crc16Tables {
+  uint16_t t[8][256];
+
+  Crc16Tables() {
+    for (int b = 0; b < 256; b++) {
+      uint16_t crc = static_cast<uint16_t>(b);
+      for (int i = 0; i < 8; i++)
+        crc = (crc & 0x0001) ? static_cast<uint16_t>((crc >> 1) ^ POLY) : static_cast<uint16_t>(crc >> 1);
+      t[0][b] = crc;
     }
+    for (int k = 1; k < 8; k++)
+      for (int b = 0; b < 256; b++)
+        t[k][b] = static_cast<uint16_t>((t[k - 1][b] >> 8) ^ t[0][t[k - 1][b] & 0xFF]);
   }
-  std::cout << std::endl;
-  crc = (~crc & 0xFFFF);
-  crc = (crc << 8) | ((crc >> 8) & 0xFF);
+};
 
-  return crc & 0xFFFF;
+inline const Crc16Tables& crc16_tables() {
+  static const Crc16Tables tables;
+  return tables;
 }
 
+inline uint16_t crc16(const uint8_t* data, size_t len) {
+  const Crc16Tables& tables = crc16_tables();
+  const uint16_t (&t)[8][256] = tables.t;
+  uint16_t crc = 0xFFFF;
 
-// https://stackoverflow.com/questions/809902/64-bit-ntohl-in-c
-uint64_t ntoh64(const uint64_t *input) {
-  uint64_t rval;
-  uint8_t *data = (uint8_t *)&rval;
+  for (; len >= 8; data += 8, len -= 8) {
+    crc ^= static_cast<uint16_t>(data[0] | (data[1] << 8));
+    crc = t[7][crc & 0xFF] ^ t[6][crc >> 8] ^
+          t[5][data[2]] ^ t[4][data[3]] ^ t[3][data[4]] ^
+          t[2][data[5]] ^ t[1][data[6]] ^ t[0][data[7]];
+  }
+  for (; len > 0; data++, len--)
+    crc = static_cast<uint16_t>((crc >> 8) ^ t[0][(crc ^ *data) & 0xFF]);
 
-  data[0] = *input >> 56;
-  data[1] = *input >> 48;
-  data[2] = *input >> 40;
-  data[3] = *input >> 32;
-  data[4] = *input >> 24;
-  data[5] = *input >> 16;
-  data[6] = *input >> 8;
-  data[7] = *input >> 0;
+  crc = (~crc & 0xFFFF);
+  crc = (crc << 8) | ((crc >> 8) & 0xFF);
 
-  return rval;
+  return crc & 0xFFFF;
 }
 
-#define htonll(x) ((1==htonl(1)) ? (x) : ((uint64_t)htonl((x) & 0xFFFFFFFF) << 32) | htonl((x) >> 32))
-#define ntohll(x) ((1==ntohl(1)) ? (x) : ((uint64_t)ntohl((x) & 0xFFFFFFFF) << 32) | ntohl((x) >> 32))
+
+inline uint16_t crc16(const std::vector<uint8_t>& data) {
+  return crc16(data.data(), data.size());
+}
 
 
 // This class implements a very compact and lightweight messaging protocol on top of
@@ -126,6 +144,10 @@ public:
   using msg_crc_t = uint16_t;
 
 
+  // Upper bound of the frame length accepted from the network
+  static const msg_len_t MAX_FRAME_LEN = 256;
+
+
   // MagicValue is how we identify messages that are our MsgProtocol messages.
   static const msg_magic_t MagicValue = 0x0E;
 
@@ -153,10 +175,16 @@ public:
   {
     MSG_CTRL = 1,
     MSG_DATA = 2,
+    MSG_SUB = 3,     // (un)subscription to the status of cars
+    MSG_STATUS = 4,  // published status of a car
     MSG_UNKNOWN
   };
 
 
+  // Destination address of the frames published to all subscribers
+  static const node_addr_t BROADCAST_ADDRESS = 0xFFFF;
+
+
   // structure of a Message header
   // full message looks like: [HEADER][payload....][crc]
   #pragma pack(push, 1)
@@ -176,7 +204,9 @@ public:
   using req_floor_t = uint8_t;
   using req_dir_t = uint8_t;
 
-  // structure of payload
+  // structure of payload. The command is a Request::Command; a status
+  // query (QUERY) carries the index of the queried car in floor_num and is
+  // answered with a status report of that car.
   #pragma pack(push, 1)
   struct msg_payload_t {
     req_time_t  timetag;   // 8-byte
@@ -187,182 +217,268 @@ public:
   #pragma pack(pop)
 
 
+  // Subscription actions
+  enum class SUB_ACTION : uint8_t
+  {
+    SUBSCRIBE = 1,
+    UNSUBSCRIBE = 2
+  };
 
-  // https://stackoverflow.com/questions/16519846/parse-ip-and-tcp-header-especially-common-tcp-header-optionsof-packets-capture
-  // Helper static function to de-serialize the packet's header
-  static msg_hdr_t deserialize_header(std::istream& stream, bool ntoh) {
-    msg_hdr_t header;
+  // Highest number of cars which can be subscribed to
+  static const size_t MAX_SUB_CARS = 64;
 
-    stream.read((char*)&header.magic, sizeof(header.magic));
-    stream.read((char*)&header.tx_node_addr, sizeof(header.tx_node_addr));
-    stream.read((char*)&header.rx_node_addr, sizeof(header.rx_node_addr));
-    stream.read((char*)&header.msg_class, sizeof(header.msg_class));
-    stream.read((char*)&header.msg_id, sizeof(header.msg_id));
-    stream.read((char*)&header.len, sizeof(header.len));
-    if(ntoh) {
-      header.tx_node_addr = ntohs(header.tx_node_addr);
-      header.rx_node_addr = ntohs(header.rx_node_addr);
-      header.msg_id =       ntohs(header.msg_id);
-      header.len =          ntohs(header.len);
-    }
+  // structure of the payload of a subscription message. Bit n of the mask
+  // selects the car with index n.
+  #pragma pack(push, 1)
+  struct msg_sub_payload_t {
+    uint8_t  action;   // 1-byte
+    uint64_t car_mask; // 8-byte
+  };
+  #pragma pack(pop)
+
+
+  // structure of the payload of a published car status
+  #pragma pack(push, 1)
+  struct msg_status_payload_t {
+    uint8_t     car_id;    // 1-byte
+    req_floor_t floor_num; // 1-byte
+    uint8_t     state;     // 1-byte
+    req_dir_t   direction; // 1-byte
+  };
+  #pragma pack(pop)
+
+
+
+  // Command field of a status report sent by the controller
+  static const req_cmd_t STATUS_COMMAND = 3;
+
+
+  // Wire sizes of the frame parts. All multi-byte fields are sent in network
+  // byte order (big endian).
+  static const size_t HDR_LEN = sizeof(msg_hdr_t);
+  static const size_t PAYLOAD_LEN = sizeof(msg_payload_t);
+  static const size_t CRC_LEN = sizeof(msg_crc_t);
+  static const size_t DATA_FRAME_LEN = HDR_LEN + PAYLOAD_LEN + CRC_LEN;
+  static const size_t SUB_FRAME_LEN = HDR_LEN + sizeof(msg_sub_payload_t) + CRC_LEN;
+  static const size_t STATUS_FRAME_LEN = HDR_LEN + sizeof(msg_status_payload_t) + CRC_LEN;
+
+
+  // Helper static functions to store and load the big endian fields
+  static void store16(uint8_t* p, uint16_t v) {
+    p[0] = static_cast<uint8_t>(v >> 8);
+    p[1] = static_cast<uint8_t>(v);
+  }
+
+  static uint16_t load16(const uint8_t* p) {
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+  }
+
+  static void store64(uint8_t* p, uint64_t v) {
+    for (int i = 7; i >= 0; i--, v >>= 8) p[i] = static_cast<uint8_t>(v);
+  }
+
+  static uint64_t load64(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; i++) v = (v << 8) | p[i];
+    return v;
+  }
+
+
+  // Helper static function to encode the packet's header into the buffer,
+  // which must hold HDR_LEN bytes
+  static void encode_header(uint8_t* buf, const msg_hdr_t& header) {
+    buf[offsetof(msg_hdr_t, magic)] = header.magic;
+    store16(buf + offsetof(msg_hdr_t, tx_node_addr), header.tx_node_addr);
+    store16(buf + offsetof(msg_hdr_t, rx_node_addr), header.rx_node_addr);
+    buf[offsetof(msg_hdr_t, msg_class)] = header.msg_class;
+    store16(buf + offsetof(msg_hdr_t, msg_id), header.msg_id);
+    store16(buf + offsetof(msg_hdr_t, len), header.len);
+  }
+
+
+  // Helper static function to decode the packet's header from the buffer
+  static msg_hdr_t decode_header(const uint8_t* buf) {
+    msg_hdr_t header;
+    header.magic = buf[offsetof(msg_hdr_t, magic)];
+    header.tx_node_addr = load16(buf + offsetof(msg_hdr_t, tx_node_addr));
+    header.rx_node_addr = load16(buf + offsetof(msg_hdr_t, rx_node_addr));
+    header.msg_class = buf[offsetof(msg_hdr_t, msg_class)];
+    header.msg_id = load16(buf + offsetof(msg_hdr_t, msg_id));
+    header.len = load16(buf + offsetof(msg_hdr_t, len));
     return header;
   }
 
 
-  // Helper static function to de-serialize the packet's payload
-  static msg_payload_t deserialize_payload(std::istream& stream, bool ntoh) {
-    msg_payload_t payload;
+  // Helper static function to encode the packet's payload into the buffer,
+  // which must hold PAYLOAD_LEN bytes
+  static void encode_payload(uint8_t* buf, const msg_payload_t& payload) {
+    store64(buf + offsetof(msg_payload_t, timetag), payload.timetag);
+    buf[offsetof(msg_payload_t, command)] = payload.command;
+    buf[offsetof(msg_payload_t, floor_num)] = payload.floor_num;
+    buf[offsetof(msg_payload_t, direction)] = payload.direction;
+  }
 
-    stream.read((char*)&payload.timetag, sizeof(payload.timetag));
-    stream.read((char*)&payload.command, sizeof(payload.command));
-    stream.read((char*)&payload.floor_num, sizeof(payload.floor_num));
-    stream.read((char*)&payload.direction, sizeof(payload.direction));
-    if(ntoh) {
-      payload.timetag = ntoh64(&payload.timetag);
-    }
+
+  // Helper static function to decode the packet's payload from the buffer
+  static msg_payload_t decode_payload(const uint8_t* buf) {
+    msg_payload_t payload;
+    payload.timetag = load64(buf + offsetof(msg_payload_t, timetag));
+    payload.command = buf[offsetof(msg_payload_t, command)];
+    payload.floor_num = buf[offsetof(msg_payload_t, floor_num)];
+    payload.direction = buf[offsetof(msg_payload_t, direction)];
     return payload;
   }
 
 
-  // Helper static function to serialize the packet's header
-  static void serialize_header(std::ostream& stream, msg_hdr_t& header, bool hton) {
-    if(hton) {
-      header.tx_node_addr = htons(header.tx_node_addr);
-      header.rx_node_addr = htons(header.rx_node_addr);
-      header.msg_id =       htons(header.msg_id);
-      header.len =          htons(header.len);
-    }
-    stream.write((char*)&header.magic, sizeof(header.magic));
-    stream.write((char*)&header.tx_node_addr, sizeof(header.tx_node_addr));
-    stream.write((char*)&header.rx_node_addr, sizeof(header.rx_node_addr));
-    stream.write((char*)&header.msg_class, sizeof(header.msg_class));
-    stream.write((char*)&header.msg_id, sizeof(header.msg_id));
-    stream.write((char*)&header.len, sizeof(header.len));
+  // Helper static function to encode a whole data frame (header, payload and
+  // CRC) into the buffer, which must hold DATA_FRAME_LEN bytes
+  static void encode_data_frame(uint8_t* buf, const msg_hdr_t& header, const msg_payload_t& payload) {
+    encode_header(buf, header);
+    encode_payload(buf + HDR_LEN, payload);
+    store16(buf + HDR_LEN + PAYLOAD_LEN, crc16(buf, HDR_LEN + PAYLOAD_LEN));
   }
 
 
-  // Helper static function to serialize the packet's payload
-  static void serialize_payload(std::ostream& stream, msg_payload_t& payload, bool hton) {
-    if(hton) {
-      payload.timetag = htonll(payload.timetag);
-    }
-    stream.write((char*)&payload.timetag, sizeof(payload.timetag));
-    stream.write((char*)&payload.command, sizeof(payload.command));
-    stream.write((char*)&payload.floor_num, sizeof(payload.floor_num));
-    stream.write((char*)&payload.direction, sizeof(payload.direction));
+  // Helper static function to encode a published car status frame into the
+  // buffer, which must hold STATUS_FRAME_LEN bytes
+  static void encode_status_frame(uint8_t* buf, const msg_hdr_t& header, const msg_status_payload_t& payload) {
+    encode_header(buf, header);
+    uint8_t* p = buf + HDR_LEN;
+    p[offsetof(msg_status_payload_t, car_id)] = payload.car_id;
+    p[offsetof(msg_status_payload_t, floor_num)] = payload.floor_num;
+    p[offsetof(msg_status_payload_t, state)] = payload.state;
+    p[offsetof(msg_status_payload_t, direction)] = payload.direction;
+    store16(buf + STATUS_FRAME_LEN - CRC_LEN, crc16(buf, STATUS_FRAME_LEN - CRC_LEN));
   }
 
 
-  // Helper static function to serialize the packet's payload
-  static void serialize_crc16(std::ostream& stream, uint16_t crc, bool hton) {
-    if(hton) {
-      crc = htons(crc);
-    }
-    stream.write((char*)&crc, sizeof(crc));
+  // Helper static function to decode the payload of a subscription frame
+  static msg_sub_payload_t decode_sub_payload(const uint8_t* buf) {
+    msg_sub_payload_t payload;
+    payload.action = buf[offsetof(msg_sub_payload_t, action)];
+    payload.car_mask = load64(buf + offsetof(msg_sub_payload_t, car_mask));
+    return payload;
   }
 
 
   // Helper static function to check the packet's health
-  static bool header_check(const msg_hdr_t& header, msg_len_t exp_len) {
+  static bool header_check(const msg_hdr_t& header, msg_len_t exp_len, MSGTYPE exp_type = MSGTYPE::MSG_DATA) {
     bool result = true;
     if (header.magic != MagicValue) {
       result = false;
-      std::cout << "Got corrupted packet: Header magic value is wrong: " << header.magic << " Expected:" << MagicValue << std::endl;
+      LOG_WARN("Got corrupted packet: Header magic value is wrong: {} Expected:{}", header.magic, MagicValue);
     }
 
     if (header.len != exp_len) {
       result = false;
-      std::cout << "Got corrupted packet: Header length value is wrong: " << header.len << " Expected:" << exp_len << std::endl;
+      LOG_WARN("Got corrupted packet: Header length value is wrong: {} Expected:{}", header.len, exp_len);
     }
 
-    if (header.msg_class != static_cast<msg_class_t>(MSGTYPE::MSG_DATA)) {
+    if (header.msg_class != static_cast<msg_class_t>(exp_type)) {
       result = false;
-      std::cout << "Got corrupted packet: Header message class is wrong: " << header.msg_class << " Expected:" << static_cast<int>(MSGTYPE::MSG_DATA) << std::endl;
+      LOG_WARN("Got corrupted packet: Header message class is wrong: {} Expected:{}", header.msg_class, exp_type);
     }
 
     return result;
   }
 
 
+  // Helper static function to check the command of a request payload. A
+  // query must name one of the num_cars cars of the group.
+  static bool payload_check(const msg_payload_t& payload, size_t num_cars) {
+    switch (static_cast<Request::Command>(payload.command)) {
+      case Request::Command::CALL:
+      case Request::Command::GO:
+        return true;
+      case Request::Command::QUERY:
+        if (payload.floor_num < num_cars)
+          return true;
+        LOG_WARN("Got corrupted packet: Queried car index is wrong: {} Cars:{}", payload.floor_num, num_cars);
+        return false;
+      default:
+        LOG_WARN("Got corrupted packet: Command is wrong: {}", payload.command);
+        return false;
+    }
+  }
+
+
+  // Helper static function to verify the trailing CRC of a frame, which
+  // covers the header and the payload
+  static bool crc_check(const uint8_t* frame, size_t len) {
+    if (len < HDR_LEN + CRC_LEN)
+      return false;
+    return load16(frame + len - CRC_LEN) == crc16(frame, len - CRC_LEN);
+  }
+
+
   // Helper static function to print the packet's header
   static void print_header(const msg_hdr_t& header) {
-    std::cout << "msg header(size:" << sizeof(msg_hdr_t)<< "):" << std::endl;
-    std::cout << "  magic:" << std::hex << (header.magic & 0xFF) << std::endl;
-    std::cout << "  tx node addr:" << std::hex << (header.tx_node_addr & 0xFFFF) << std::endl;
-    std::cout << "  rx node addr:" << std::hex << (header.rx_node_addr & 0xFFFF) << std::endl;
-    std::cout << "  msg class:" << std::hex << (header.msg_class & 0xFF) << std::endl;
-    std::cout << "  msg id:" << std::hex << (header.msg_id & 0xFFFF) << std::endl;
-    std::cout << "  len:" << std::hex << (header.len & 0xFFFF) << std::endl;
+    LOG_DEBUG("msg header: magic:{} tx node addr:{} rx node addr:{} msg class:{} msg id:{} len:{}",
+              Logger::hex(header.magic), Logger::hex(header.tx_node_addr), Logger::hex(header.rx_node_addr),
+              Logger::hex(header.msg_class), Logger::hex(header.msg_id), Logger::hex(header.len));
   }
 
 
   // Helper static function to print the packet's payload
   static void print_payload(const msg_payload_t& payload) {
-    std::cout << "msg payload:" << std::endl;
-    std::cout << "  timetag:" << std::hex << (payload.timetag & 0xFFFFFFFFFFFFFFFF) << std::endl;
-    std::cout << "  command:" << std::hex << (payload.command & 0xFF) << std::endl;
-    std::cout << "  floor number:" << std::hex << (payload.floor_num & 0xFF) << std::endl;
-    std::cout << "  direction:" << std::hex << (payload.direction & 0xFF) << std::endl;
+    LOG_DEBUG("msg payload: timetag:{} command:{} floor number:{} direction:{}",
+              Logger::hex(payload.timetag), Logger::hex(payload.command),
+              Logger::hex(payload.floor_num), Logger::hex(payload.direction));
   }
 
 
-  // Helper static function to handle the incoming packet from transport layer
-  // It performs the following actions:
-  //  - Parsing the packet header
-  //  - Checking packet's sanity
-  //  - Replying ACK/NACK to the transmitter
-  //  - Parsing the packet payload
-  // ToDo: This function returns a Request object. It might be a better
-  //       strategy to easily pack the output data fields into a simple
-  //       tuple!
-  static Request handle(std::weak_ptr<TransportSocket::ClientSocket> socket, std::vector<uint8_t>& packet) {
-	// Parse the packet header, check packet's sanity and reply ACK/NAK
-    // Extract packet header
-    std::istringstream stream(std::string((char*)&packet[0], packet.size()));
-    stream.seekg(0, std::ios_base::beg);
-    auto msg_header = MsgProtocol::deserialize_header(stream, true);
-    print_header(msg_header);
+  // Helper static function to cut the next complete frame out of the receive
+  // buffer of a connection into the frame buffer, which must hold
+  // MAX_FRAME_LEN bytes. The frame length is taken from the header, so
+  // coalesced frames are extracted one after another and the bytes of a
+  // partial frame stay buffered until the rest arrives. Bytes which cannot
+  // start a frame are skipped to resynchronize on the next magic value.
+  // Returns the length of the frame, or 0 if no complete frame is buffered.
+  static size_t extract_frame(ByteRing& rx, uint8_t* frame) {
+    while (rx.size() >= HDR_LEN) {
+      if (rx.at(0) != MagicValue) {
+        rx.consume(1);
+        continue;
+      }
 
+      size_t offset = offsetof(msg_hdr_t, len);
+      msg_len_t len = static_cast<msg_len_t>((rx.at(offset) << 8) | rx.at(offset + 1));
+      if (len < HDR_LEN || len > MAX_FRAME_LEN) {
+        LOG_WARN("Got corrupted packet: Header length value is out of range: {}", len);
+        rx.consume(1);
+        continue;
+      }
 
-    // Check packet
-    bool packetCheck = header_check(msg_header, msg_header.len);
+      if (rx.size() < len)
+        return 0;
 
-    uint16_t tx_node_addr = msg_header.tx_node_addr;
-    uint16_t msg_id = msg_header.msg_id;
+      rx.copyOut(0, frame, len);
+      rx.consume(len);
+      return len;
+    }
+    return 0;
+  }
 
 
+  // Helper static function to reply an ACK/NAK to the transmitter of the
+  // packet with the given header
+  static void reply(std::weak_ptr<Connection> socket, msg_hdr_t msg_header, bool ack) {
+    Tracer::event(ack ? TraceEvent::Type::ACK : TraceEvent::Type::NAK, 0, msg_header.tx_node_addr, msg_header.msg_id, 0, 0);
+
     // Prepare the replay packet
     auto tmp = msg_header.tx_node_addr;
     msg_header.tx_node_addr = msg_header.rx_node_addr;
     msg_header.rx_node_addr = tmp;
 
-    if (packetCheck)  msg_header.msg_class = static_cast<msg_class_t>(static_cast<uint8_t>(MSGTYPE::MSG_CTRL) | static_cast<uint8_t>(MSG_OPTYPE::OP_ACK));
-    else              msg_header.msg_class = static_cast<msg_class_t>(static_cast<uint8_t>(MSGTYPE::MSG_CTRL) | static_cast<uint8_t>(MSG_OPTYPE::OP_NAK));
-
-    msg_header.len = sizeof(msg_hdr_t);
+    if (ack)  msg_header.msg_class = static_cast<msg_class_t>(static_cast<uint8_t>(MSGTYPE::MSG_CTRL) | static_cast<uint8_t>(MSG_OPTYPE::OP_ACK));
+    else      msg_header.msg_class = static_cast<msg_class_t>(static_cast<uint8_t>(MSGTYPE::MSG_CTRL) | static_cast<uint8_t>(MSG_OPTYPE::OP_NAK));
 
-    // ////////////////////////////////////////////
-    // Send back the reply packet as ACK/NAK
-    // ToDo: Here it should be checked to optimize the code
-    //       to avoid unnecessary memory copy.
-    std::ostringstream ostream(std::ostringstream::ate);
-    serialize_header(ostream, msg_header, true);
-    std::vector<uint8_t> buffer;
-    const std::string& str = ostream.str();
-    buffer.insert(buffer.end(), str.begin(), str.end());
-    socket.lock()->write(buffer);
+    msg_header.len = HDR_LEN;
 
-    // ////////////////////////////////////////////
-    // Parse the packet's payload
-    stream.seekg(sizeof(msg_hdr_t), std::ios_base::beg);
-    auto msg_payload = MsgProtocol::deserialize_payload(stream, true);
-    print_payload(msg_payload);
-    return (Request(tx_node_addr,
-    		        msg_id,
-					msg_payload.timetag,
-					static_cast<Request::Command>(msg_payload.command),
-					msg_payload.floor_num,
-					static_cast<Request::Direction>(msg_payload.direction)));
+    uint8_t buffer[HDR_LEN];
+    encode_header(buffer, msg_header);
+    if (auto s = socket.lock())
+      s->write(buffer, sizeof(buffer));
   }
 
 
@@ -370,44 +486,251 @@ public:
   // It performs the following actions:
   //  - Parsing the packet header
   //  - Checking packet's sanity
+  //  - Parsing and checking the packet payload against the number of cars
   //  - Replying ACK/NACK to the transmitter
-  //  - Parsing the packet payload
-  static void xmit(std::weak_ptr<TransportSocket::ClientSocket> socket, std::tuple<uint16_t, uint16_t, uint8_t, uint8_t, uint8_t>& cmd_tuple) {
+  // The fields are decoded in place from the frame buffer. Returns false if
+  // the packet has been rejected with a NAK, so an accepted command is one
+  // the controller is able to serve.
+  static bool handle(std::weak_ptr<Connection> socket, const uint8_t* frame, size_t len, size_t num_cars, CarCommand& command) {
+    // Parse the packet header, check packet's sanity and reply ACK/NAK
+    auto msg_header = decode_header(frame);
+    print_header(msg_header);
+
+    // Check packet
+    bool packetCheck = header_check(msg_header, static_cast<msg_len_t>(DATA_FRAME_LEN)) && len == DATA_FRAME_LEN;
+    if (packetCheck && !crc_check(frame, len)) {
+      packetCheck = false;
+      LOG_WARN("Got corrupted packet: CRC is wrong");
+    }
+
+    // ////////////////////////////////////////////
+    // Parse the packet's payload
+    msg_payload_t msg_payload{};
+    if (packetCheck) {
+      msg_payload = decode_payload(frame + HDR_LEN);
+      print_payload(msg_payload);
+      packetCheck = payload_check(msg_payload, num_cars);
+    }
+
+    // Send back the reply packet as ACK/NAK
+    reply(socket, msg_header, packetCheck);
+
+    if (!packetCheck)
+      return false;
+
+    command = CarCommand{msg_header.tx_node_addr,
+                         msg_header.msg_id,
+                         static_cast<Request::Command>(msg_payload.command),
+                         msg_payload.floor_num,
+                         static_cast<Request::Direction>(msg_payload.direction)};
+    return true;
+  }
+
+
+  // Helper static function to handle an incoming subscription packet. It is
+  // checked and replied with ACK/NAK like a request packet. Returns false if
+  // the packet has been rejected with a NAK.
+  static bool handle_subscription(std::weak_ptr<Connection> socket, const uint8_t* frame, size_t len, msg_sub_payload_t& subscription) {
+    auto msg_header = decode_header(frame);
+
+    bool packetCheck = header_check(msg_header, static_cast<msg_len_t>(SUB_FRAME_LEN), MSGTYPE::MSG_SUB) && len == SUB_FRAME_LEN;
+    if (packetCheck && !crc_check(frame, len)) {
+      packetCheck = false;
+      LOG_WARN("Got corrupted packet: CRC is wrong");
+    }
+
+    if (packetCheck) {
+      subscription = decode_sub_payload(frame + HDR_LEN);
+      if (subscription.action != static_cast<uint8_t>(SUB_ACTION::SUBSCRIBE) &&
+          subscription.action != static_cast<uint8_t>(SUB_ACTION::UNSUBSCRIBE)) {
+        packetCheck = false;
+        LOG_WARN("Got corrupted packet: Subscription action is wrong: {}", subscription.action);
+      }
+    }
+
+    reply(socket, msg_header, packetCheck);
+    return packetCheck;
+  }
+
+
+  // Helper static function to transmit a status report of the controller
+  // to the requester node. The frame is encoded into a buffer on the stack
+  // and queued; a status report may be dropped in favour of a newer one when
+  // the requester does not keep up. On the wire, the direction field of a
+  // status report carries the state of the car.
+  static void xmit(std::weak_ptr<Connection> socket, const CarStatus& status) {
     msg_hdr_t header;
     msg_payload_t payload;
     payload.timetag = 0xa;
-    std::tie(header.rx_node_addr, header.msg_id, payload.command, payload.floor_num, payload.direction) = cmd_tuple;
+    payload.command = STATUS_COMMAND;
+    payload.floor_num = status.floor;
+    payload.direction = static_cast<req_dir_t>(status.state);
+    header.rx_node_addr = status.node_addr;
+    header.msg_id = status.msg_id;
 
     header.magic = MagicValue;
     header.tx_node_addr = NODE_ADDRESS;
-    header.msg_class = 0x02;
-    header.len = 23;
+    header.msg_class = static_cast<msg_class_t>(MSGTYPE::MSG_DATA);
+    header.len = DATA_FRAME_LEN;
 
-    // /////////////////////////////////////////////////////
-    // Send back the reply packet as ACK/NAK
-    // ToDo: This section needs to be optimized to avoid unnecessary
-    //       memory copy!
-    std::ostringstream ostream(std::ostringstream::ate);
-    serialize_header(ostream, header, true);
+    uint8_t buffer[DATA_FRAME_LEN];
+    encode_data_frame(buffer, header, payload);
+    if (auto s = socket.lock())
+      s->write(buffer, sizeof(buffer), true);
+  }
 
-    ostream.seekp(sizeof(msg_hdr_t), std::ios_base::beg);
-    serialize_payload(ostream, payload, true);
+};
 
-    std::vector<uint8_t> buffer;
-    const std::string& str = ostream.str();
-    buffer.insert(buffer.end(), str.begin(), str.end());
-    uint16_t crc = crc16(buffer);
-    ostream.seekp(sizeof(msg_hdr_t)+sizeof(msg_payload_t), std::ios_base::beg);
-    serialize_crc16(ostream, crc, true);
 
-    {
-    std::vector<uint8_t> buffer;
-    const std::string& str = ostream.str();
-    buffer.insert(buffer.end(), str.begin(), str.end());
-    socket.lock()->write(buffer);
+
+// Routing table of the requester nodes. The connection of a node is learned
+// from the transmitter address of the frames it sends, so that the status
+// reports of the controller go back to the node's own connection. A node
+// which reconnects, or shows up on another connection, is moved there by its
+// next frame; the routes of a connection are removed when it is closed.
+class RoutingTable : noncopyable {
+public:
+  // Routes the node to the connection the frame has been received from
+  void learn(uint16_t node_addr, const std::shared_ptr<Connection>& socket) {
+    int fd = socket->fileDescriptor();
+    std::lock_guard<std::mutex> lock(mutex_);
+    Route& route = routes_[node_addr];
+    if (route.fd == fd && !route.socket.expired())
+      return;
+    if (route.fd != fd) {
+      // The node leaves the list of its former connection
+      auto itNodes = nodes_.find(route.fd);
+      if (itNodes != nodes_.end()) {
+        auto& nodes = itNodes->second;
+        nodes.erase(std::remove(nodes.begin(), nodes.end(), node_addr), nodes.end());
+        if (nodes.empty())
+          nodes_.erase(itNodes);
+      }
+      nodes_[fd].push_back(node_addr);
+    }
+    route.socket = socket;
+    route.fd = fd;
+  }
+
+  // Connection of the node; an empty pointer if the node has no route
+  std::weak_ptr<Connection> lookup(uint16_t node_addr) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto itRoute = routes_.find(node_addr);
+    if (itRoute == routes_.end())
+      return std::weak_ptr<Connection>();
+    return itRoute->second.socket;
+  }
+
+  // Removes the routes leading to a closed connection. Nodes which have
+  // moved to another connection in the meantime keep their route.
+  void forget(int fd) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto itNodes = nodes_.find(fd);
+    if (itNodes == nodes_.end())
+      return;
+    for (uint16_t node_addr : itNodes->second) {
+      auto itRoute = routes_.find(node_addr);
+      if (itRoute != routes_.end() && itRoute->second.fd == fd)
+        routes_.erase(itRoute);
+    }
+    nodes_.erase(itNodes);
+  }
+
+  // Number of routed nodes
+  size_t size() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return routes_.size();
+  }
+
+  // Number of nodes routed to the connection
+  size_t size(int fd) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto itNodes = nodes_.find(fd);
+    return (itNodes == nodes_.end()) ? 0 : itNodes->second.size();
+  }
+
+private:
+  struct Route {
+    std::weak_ptr<Connection> socket;
+    int fd = -1;
+  };
+
+  std::mutex mutex_;
+  std::unordered_map<uint16_t, Route> routes_;        // node address -> connection
+  std::unordered_map<int, std::vector<uint16_t>> nodes_; // connection -> node addresses
+};
+
+
+
+// Subscribers to the status of the cars. The subscriber list of a car is
+// copied on every change and replaced as a whole, so a publisher only takes
+// a reference to the current list and walks it without holding the lock.
+// The subscriptions of a connection are removed when it is closed.
+class SubscriberTable : noncopyable {
+public:
+  struct Subscriber {
+    std::weak_ptr<Connection> socket;
+    int fd;
+  };
+  using Subscribers = std::vector<Subscriber>;
+
+  // ctor
+  SubscriberTable() : cars_(MsgProtocol::MAX_SUB_CARS, std::make_shared<const Subscribers>()) {}
+
+  // Subscribes the connection to the cars selected by the mask
+  void subscribe(const std::shared_ptr<Connection>& socket, uint64_t car_mask) {
+    int fd = socket->fileDescriptor();
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t& mask = masks_[fd];
+    uint64_t added = car_mask & ~mask;
+    mask |= car_mask;
+    for (size_t car = 0; car < cars_.size(); car++) {
+      if ((added & (uint64_t(1) << car)) == 0)
+        continue;
+      auto subscribers = std::make_shared<Subscribers>(*cars_[car]);
+      subscribers->push_back(Subscriber{socket, fd});
+      cars_[car] = std::move(subscribers);
+    }
+  }
+
+  // Unsubscribes the connection from the cars selected by the mask
+  void unsubscribe(int fd, uint64_t car_mask) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto itMask = masks_.find(fd);
+    if (itMask == masks_.end())
+      return;
+    uint64_t removed = car_mask & itMask->second;
+    itMask->second &= ~car_mask;
+    if (itMask->second == 0)
+      masks_.erase(itMask);
+    for (size_t car = 0; car < cars_.size(); car++) {
+      if ((removed & (uint64_t(1) << car)) == 0)
+        continue;
+      auto subscribers = std::make_shared<Subscribers>();
+      for (const auto& subscriber : *cars_[car])
+        if (subscriber.fd != fd)
+          subscribers->push_back(subscriber);
+      cars_[car] = std::move(subscribers);
     }
   }
 
+  // Removes all subscriptions of a closed connection
+  void forget(int fd) {
+    unsubscribe(fd, ~uint64_t(0));
+  }
+
+  // Current subscribers of a car
+  std::shared_ptr<const Subscribers> subscribers(uint8_t car_id) {
+    if (car_id >= cars_.size())
+      return nullptr;
+    std::lock_guard<std::mutex> lock(mutex_);
+    return cars_[car_id];
+  }
+
+private:
+  std::mutex mutex_;
+  std::vector<std::shared_ptr<const Subscribers>> cars_;  // car index -> subscribers
+  std::unordered_map<int, uint64_t> masks_;               // connection -> subscribed cars
 };
 
 
@@ -420,109 +743,208 @@ class NetProtocol : public Stoppable {
 private:
 
   // Signals and slots Observer Pattern which notifies the generation of a new OUTPUT DATA
-  std::shared_ptr<signal_slot<std::tuple<uint16_t, uint16_t, uint8_t, uint8_t, uint8_t>&>> onNewData_;
+  std::shared_ptr<signal_slot<const CarCommand&>> onNewData_;
+
+  // Transport of the requester connections; a TCP/IP transport socket
+  // unless another transport has been given
+  std::shared_ptr<Transport> transport_;
+
+  // Connections of the requester nodes
+  RoutingTable routes_;
 
-  // Member variable for holding an instance of transport socket
-  std::unique_ptr<TransportSocket> transportSocket_;
+  // Subscribers to the car status and sequence number of the published frames
+  SubscriberTable subscribers_;
+  std::atomic<uint16_t> statusSeq_{0};
 
-  // tuple type Output items vector from network protocol handler task
-  std::tuple<uint16_t, uint16_t, uint8_t, uint8_t, uint8_t> output_items_;
+  // Time from receiving a request frame until its ACK/NAK has been queued
+  // for sending, in nanoseconds; recorded by the I/O threads
+  ShardedHistogram ackLatency_;
 
-  std::weak_ptr<TransportSocket::ClientSocket> socket_;
+  // Request and subscription frames answered with an ACK and with a NAK
+  std::shared_ptr<Counter> acks_;
+  std::shared_ptr<Counter> naks_;
+
+  // Number of cars of the controller; queries of other cars are rejected
+  size_t numCars_;
 public:
-  // ctor
-  NetProtocol() : output_items_(std::make_tuple(0, 0, 0, 0, 0)) {
-    onNewData_ = std::make_shared<signal_slot<std::tuple<uint16_t, uint16_t, uint8_t, uint8_t, uint8_t>&>>();
-    transportSocket_ = std::unique_ptr<TransportSocket>(new TransportSocket(90000));
+  // ctor; the handlers are attached to the transport right away, so that a
+  // transport which is driven by its owner (e.g. a loopback transport in a
+  // simulation) is served without running the thread loop
+  explicit NetProtocol(std::shared_ptr<Transport> transport = nullptr, size_t num_cars = 1) : transport_(transport), numCars_(num_cars) {
+    onNewData_ = std::make_shared<signal_slot<const CarCommand&>>();
+    acks_ = MetricsRegistry::instance().counter("net_frames_total", "Frames answered by the protocol handler.", "reply=\"ack\"");
+    naks_ = MetricsRegistry::instance().counter("net_frames_total", "Frames answered by the protocol handler.", "reply=\"nak\"");
+    if (!transport_) {
+      auto socket = std::make_shared<TransportSocket>(std::stoi(DEFAULT_PORT));
+      // Thousands of requesters may connect at once
+      socket->setBacklog(SOMAXCONN);
+      transport_ = socket;
+    }
+    attachHandlers();
+    // A stop request interrupts the transport's wait
+    onStop([this]() { transport_->interrupt(); });
   }
 
 
   // dtor
   ~NetProtocol() {
     onNewData_ = nullptr;
-    transportSocket_ = nullptr;
+    transport_ = nullptr;
   }
 
 
   // Signals and slots Observer Pattern which emits a new output data
-  void emitNewData() {
-    onNewData_->emit(output_items_);
+  void emitNewData(const CarCommand& command) {
+    onNewData_->emit(command);
+  }
+
+  // Status callback method which is being called by the controller for
+  // every status report to a requester node
+  void input_data_consumer(const CarStatus& status) {
+    LOG_DEBUG("NetProtocol: input_data_consumer: ({},{},{})", status.car_id, status.floor, status.state);
+    auto socket = routes_.lookup(status.node_addr);
+    if (socket.expired()) {
+      LOG_WARN("NetProtocol: no route to node {}", Logger::hex(status.node_addr));
+      return;
+    }
+    MsgProtocol::xmit(socket, status);
+    Tracer::event(TraceEvent::Type::SEND, status.car_id, status.node_addr, status.msg_id, status.floor, static_cast<uint8_t>(status.state));
   }
 
-  // Input callback method which is being called by the network layer as soon as
-  // each input command request is being received
-  void input_data_consumer(std::tuple<uint16_t, uint16_t, uint8_t, uint8_t, uint8_t>& cmd_tuple) {
-    uint8_t cmd, floor_num, status;
-    uint16_t node_addr, msg_id;
-    std::tie(node_addr, msg_id, cmd, floor_num, status) = cmd_tuple;
-    std::cout << "NetProtocol: input_data_consumer: (" << (cmd&0xFF) << "," << (floor_num&0xFF) << "," << (status&0xFF) << ")" << std::endl;
-    MsgProtocol::xmit(socket_, cmd_tuple);
+  // Status callback method which is being called by the controller on every
+  // change of a car's position or state. The status frame is encoded once
+  // and the same reference counted buffer is queued to all subscribers of
+  // the car.
+  void publish(const CarStatus& status) {
+    MsgProtocol::msg_status_payload_t payload;
+    payload.car_id = status.car_id;
+    payload.floor_num = status.floor;
+    payload.state = static_cast<uint8_t>(status.state);
+    payload.direction = static_cast<MsgProtocol::req_dir_t>(status.direction);
+
+    auto subscribers = subscribers_.subscribers(payload.car_id);
+    if (!subscribers || subscribers->empty())
+      return;
+
+    MsgProtocol::msg_hdr_t header;
+    header.magic = MsgProtocol::MagicValue;
+    header.tx_node_addr = NODE_ADDRESS;
+    header.rx_node_addr = MsgProtocol::BROADCAST_ADDRESS;
+    header.msg_class = static_cast<MsgProtocol::msg_class_t>(MsgProtocol::MSGTYPE::MSG_STATUS);
+    header.msg_id = statusSeq_.fetch_add(1, std::memory_order_relaxed);
+    header.len = MsgProtocol::STATUS_FRAME_LEN;
+
+    auto buffer = std::make_shared<std::vector<uint8_t>>(MsgProtocol::STATUS_FRAME_LEN);
+    MsgProtocol::encode_status_frame(buffer->data(), header, payload);
+    std::shared_ptr<const std::vector<uint8_t>> frame = std::move(buffer);
+
+    for (const auto& subscriber : *subscribers)
+      if (auto s = subscriber.socket.lock())
+        s->write(frame, true);
   }
 
   // Getter interface for the new DATA Signal/Slot
-  std::shared_ptr<signal_slot<std::tuple<uint16_t, uint16_t, uint8_t, uint8_t, uint8_t>&>> getOnNewDataGen() { return onNewData_; };
+  std::shared_ptr<signal_slot<const CarCommand&>> getOnNewDataGen() { return onNewData_; };
+
+  // Getter interface for the subscribers to the car status
+  SubscriberTable& subscribers() { return subscribers_; }
+
+  // Adds the ACK latencies of the request frames to the histogram
+  void ackLatency(LatencyHistogram& out) const { ackLatency_.mergeInto(out); }
 
 
   // Thread loop method
   void run() {
-    std::cout << "Net Application Starting..." << std::endl;
+    LOG_INFO("Net Application Starting...");
+
+    auto function = [&]() -> bool { return stopRequested(); };
+    // Invoking the transport listener method
+    transport_->listen(function);
+
+    LOG_INFO("Net Application exits.");
+  }
 
-    // Defining the onAccept callback for transport socket
-    transportSocket_->onAccept( [&] ( std::weak_ptr<TransportSocket::ClientSocket> socket )
+private:
+  // Sets the handlers of the transport's events
+  void attachHandlers() {
+    // Defining the onAccept callback for the transport
+    transport_->onAccept( [this] ( std::weak_ptr<Connection> socket )
     {
-  	  std::cout << "onAccept" << std::endl;
+  	  LOG_DEBUG("onAccept");
 
       if( auto s = socket.lock() ) {
-        std::cout << "Connection accepted..." << std::endl;
-        socket_ = socket;
+        LOG_INFO("Connection accepted...");
 //        s->close();
       }
     } );
 
 
+    // Defining the onClose callback for the transport
+    transport_->onClose( [this] ( std::weak_ptr<Connection> socket )
+    {
+      if( auto s = socket.lock() ) {
+        routes_.forget(s->fileDescriptor());
+        subscribers_.forget(s->fileDescriptor());
+      }
+    } );
+
+
 
-    // Defining the onRead callback for transport socket
-    transportSocket_->onRead( [&] ( std::weak_ptr<TransportSocket::ClientSocket> socket )
+    // Defining the onRead callback for the transport
+    transport_->onRead( [this] ( std::weak_ptr<Connection> socket )
     {
-      std::cout << "onRead" << std::endl;
+      LOG_DEBUG("onRead");
 
       if( auto s = socket.lock() ) {
-        std::vector<uint8_t> packet = s->read();
-
-        // Printing the packet contents for debugging
-        for (auto v : packet)
-          std::cout << std::hex << (v & 0xFF) << " " << std::dec;
-        std::cout << std::endl;
-
-        // //////////////////////////////////////////////////////////////
-        // Passing the received packet to Message Protocol class handler
-        // ToDo: Here we receive the data from MsgProtocol::handle as a
-        //       Request object and then we copy it into a tuple to emit it
-        //       to the elevator's controller. This is an unnecessary operation
-        //       which tasks time and resource. Hence, an optimization here should
-        //       be done to use either tuple or Request for the whole scenario and
-        //       instead of copy, use move concept.
-        Request req = MsgProtocol::handle(s, packet);
-
-        output_items_ = std::make_tuple(req.node_addr_,
-                                        req.msg_id_,
-       	                                static_cast<uint8_t>(req.cmd_),
-        		                        req.floor_,
-										static_cast<uint8_t>(req.direction_)); // call|go, floorNum, Up|Down
-        std::cout << "NetProtocol: (" << std::hex << req.node_addr_ << "," << req.msg_id_ << "," << (static_cast<uint8_t>(req.cmd_)&0xFF) << "," << (req.floor_&0xFF) << "," << (static_cast<uint8_t>(req.direction_)&0xFF) << ")" << std::endl;
-
-        // Emit the extracted user's request to the elevator's core controller
-        emitNewData();
+        // Every complete frame in the receive buffer is handled; a partial
+        // frame stays there until the next read
+        uint8_t packet[MsgProtocol::MAX_FRAME_LEN];
+        size_t len;
+        bool drained;
+        do {
+          drained = s->receive();
+          auto received = std::chrono::steady_clock::now();
+          while ((len = MsgProtocol::extract_frame(s->rxBuffer(), packet)) != 0) {
+            // Printing the packet contents for debugging
+            LOG_DEBUG("frame: {}", Logger::bytes(packet, len));
+
+            // Subscriptions are kept by the network layer and do not reach
+            // the controller
+            if (packet[offsetof(MsgProtocol::msg_hdr_t, msg_class)] == static_cast<uint8_t>(MsgProtocol::MSGTYPE::MSG_SUB)) {
+              MsgProtocol::msg_sub_payload_t subscription;
+              bool subscribed = MsgProtocol::handle_subscription(s, packet, len, subscription);
+              (subscribed ? acks_ : naks_)->add();
+              if (!subscribed)
+                continue;
+              if (subscription.action == static_cast<uint8_t>(MsgProtocol::SUB_ACTION::SUBSCRIBE))
+                subscribers_.subscribe(s, subscription.car_mask);
+              else
+                subscribers_.unsubscribe(s->fileDescriptor(), subscription.car_mask);
+              continue;
+            }
+
+            // //////////////////////////////////////////////////////////////
+            // Passing the received packet to Message Protocol class handler,
+            // which decodes it straight into the command handed over to the
+            // elevator's controller
+            CarCommand command;
+            bool accepted = MsgProtocol::handle(s, packet, len, numCars_, command);
+            ackLatency_.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - received).count()));
+            (accepted ? acks_ : naks_)->add();
+            if (!accepted)
+              continue;
+            routes_.learn(command.node_addr, s);
+
+            LOG_DEBUG("NetProtocol: ({},{},{},{},{})", Logger::hex(command.node_addr), Logger::hex(command.msg_id), command.cmd, command.floor, command.direction);
+
+            // Emit the extracted user's request to the elevator's core controller
+            emitNewData(command);
+          }
+        } while (!drained);
 
 //        s->close();
       }
     } );
-
-    auto function = [&]() -> bool { return stopRequested(); };
-    // Invoking the transport socket listener method
-    transportSocket_->listen(function);
-
-    std::cout << "Net Application exits." << std::endl;
   }
 
 };
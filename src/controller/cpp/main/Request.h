@@ -38,8 +38,9 @@
 // It encapsulates the timetag, command, floor number, and direction.
 class Request {
 public:
-  // Command type
-  enum class Command : uint8_t { CALL = 1, GO };
+  // Command type. 3 is the command of a status report sent by the
+  // controller, so a query has a value of its own.
+  enum class Command : uint8_t { CALL = 1, GO, QUERY = 4 };
   // Direction type
   enum class Direction : uint8_t { UP = 1, DOWN };
 
@@ -72,46 +73,12 @@ public:
   }
 
 
-  Request(const Request& rhs)
-        : node_addr_(rhs.node_addr_),
-		  msg_id_(rhs.msg_id_),
-		  time_(rhs.time_),
-		  cmd_(rhs.cmd_),
-		  floor_(rhs.floor_),
-		  direction_(rhs.direction_),
-		  ok_(rhs.ok_)
-  {
-  }
-
-
-  Request& operator=(const Request& rhs) {
-    if (this != &rhs) {
-      node_addr_ = rhs.node_addr_;
-   	  msg_id_ = rhs.msg_id_;
-  	  time_ = rhs.time_;
-  	  cmd_ = rhs.cmd_;
-  	  floor_ = rhs.floor_;
-  	  direction_ = rhs.direction_;
-    }
-    return (*this);
-  }
+  // Requests are trivially copyable, so they are handed over through the
+  // ingress ring by plain copies
+  Request(const Request& rhs) = default;
+  Request& operator=(const Request& rhs) = default;
 
 };
 
 
-struct upComparator {
-  bool operator()(Request const & p1, Request const & p2) {
-    // return "true" if "p1" is ordered before "p2", for example:
-    return p1.floor_ < p2.floor_;
-  }
-};
-
-
-struct downComparator {
-  bool operator()(Request const & p1, Request const & p2) {
-    // return "true" if "p1" is ordered before "p2", for example:
-    return p1.floor_ >= p2.floor_;
-  }
-};
-
 #endif /* D_ELEVATOR_REQUEST_H */
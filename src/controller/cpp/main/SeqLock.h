@@ -0,0 +1,75 @@
+/*
+ * @file   SeqLock.h
+ * @author Armin Zare Zadeh, ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   Sequence lock protecting a small value with a single writer.
+ *          It is being used for publishing the state of a car to the
+ *          threads which query it, without ever blocking the controller.
+ */
+
+#ifndef D_SEQ_LOCK_H
+#define D_SEQ_LOCK_H
+
+#include "NonCopyable.h"
+
+#include <atomic>
+#include <type_traits>
+#include <cstring>
+#include <cstdint>
+
+
+
+// The writer makes the sequence number odd, stores the value and makes the
+// sequence number even again. A reader copies the value and retries if the
+// sequence number was odd or has changed in the meantime, so readers never
+// write shared memory and cannot slow down the writer. The value is kept in
+// atomic words, so a torn read is detected instead of being a data race.
+template <typename T>
+class SeqLock : noncopyable {
+  static_assert(std::is_trivially_copyable<T>::value, "SeqLock value must be trivially copyable");
+
+private:
+  static const size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+  std::atomic<uint32_t> seq_;
+  std::atomic<uint64_t> words_[WORDS];
+
+public:
+  // ctor
+  explicit SeqLock(const T& value = T()) : seq_(0) {
+    for (size_t i = 0; i < WORDS; i++) words_[i].store(0, std::memory_order_relaxed);
+    store(value);
+  }
+
+  // Writer side; must only be called by one thread at a time
+  void store(const T& value) {
+    uint64_t buf[WORDS] = {};
+    memcpy(buf, &value, sizeof(T));
+
+    uint32_t seq = seq_.load(std::memory_order_relaxed);
+    seq_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < WORDS; i++) words_[i].store(buf[i], std::memory_order_relaxed);
+    seq_.store(seq + 2, std::memory_order_release);
+  }
+
+  // Reader side; returns a consistent copy of the last stored value
+  T load() const {
+    uint64_t buf[WORDS];
+    uint32_t before, after;
+    do {
+      before = seq_.load(std::memory_order_acquire);
+      for (size_t i = 0; i < WORDS; i++) buf[i] = words_[i].load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      after = seq_.load(std::memory_order_relaxed);
+    } while ((before & 1) != 0 || before != after);
+
+    T value;
+    memcpy(&value, buf, sizeof(T));
+    return value;
+  }
+};
+
+
+#endif /* D_SEQ_LOCK_H */
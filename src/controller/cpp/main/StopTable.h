@@ -0,0 +1,182 @@
+/*
+ * @file   StopTable.h
+ * @author Armin Zare Zadeh, ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   Per-floor stop table for LOOK/SCAN scheduling of a car.
+ *          Pending stops are kept in fixed size floor bitsets, one per
+ *          hall call direction plus one for car calls, together with
+ *          the list of requests waiting at each stop.
+ */
+
+#ifndef D_STOP_TABLE_H
+#define D_STOP_TABLE_H
+
+#include "Request.h"
+
+#include <vector>
+#include <cstdint>
+
+
+
+// Fixed size set of floors. Floors are bits in four 64-bit words, so that the
+// nearest floor in either direction is found with at most four word scans.
+class FloorSet {
+public:
+  static const size_t MAX_FLOORS = 256;
+  static const int NONE = -1;
+
+  FloorSet() : words_{0, 0, 0, 0} {}
+
+  void set(uint8_t floor) { words_[floor >> 6] |= bit(floor); }
+  void reset(uint8_t floor) { words_[floor >> 6] &= ~bit(floor); }
+  bool test(uint8_t floor) const { return (words_[floor >> 6] & bit(floor)) != 0; }
+  bool any() const { return (words_[0] | words_[1] | words_[2] | words_[3]) != 0; }
+
+  FloorSet operator|(const FloorSet& rhs) const {
+    FloorSet result;
+    for (int i = 0; i < WORDS; i++) result.words_[i] = words_[i] | rhs.words_[i];
+    return result;
+  }
+
+  // Lowest floor in the set which is >= floor, or NONE
+  int lowestFrom(uint8_t floor) const {
+    int w = floor >> 6;
+    uint64_t word = words_[w] & (~uint64_t(0) << (floor & 63));
+    while (true) {
+      if (word != 0) return (w << 6) + __builtin_ctzll(word);
+      if (++w == WORDS) return NONE;
+      word = words_[w];
+    }
+  }
+
+  // Highest floor in the set which is <= floor, or NONE
+  int highestTo(uint8_t floor) const {
+    int w = floor >> 6;
+    uint64_t word = words_[w] & (~uint64_t(0) >> (63 - (floor & 63)));
+    while (true) {
+      if (word != 0) return (w << 6) + 63 - __builtin_clzll(word);
+      if (--w < 0) return NONE;
+      word = words_[w];
+    }
+  }
+
+private:
+  static const int WORDS = MAX_FLOORS / 64;
+  static uint64_t bit(uint8_t floor) { return uint64_t(1) << (floor & 63); }
+
+  uint64_t words_[WORDS];
+};
+
+
+// Stop table of a single car. Each (floor, kind) pair is one stop no matter
+// how many requests are waiting for it, so repeated calls to the same floor
+// are merged. Adding a request and looking up the next stop take constant
+// time and the per-stop waiting lists keep their capacity between trips,
+// which keeps the work per request flat under call storms.
+class StopTable {
+public:
+  // Kind of a stop: hall call up, hall call down or car call ("go")
+  enum class Kind : uint8_t { UP = 0, DOWN, CAR };
+  static const size_t NUM_KINDS = 3;
+
+  // Next stop of a LOOK sweep: the floor to go to and the direction in which
+  // the car leaves it, which selects the hall calls served there
+  struct Stop {
+    int floor;
+    Request::Direction direction;
+  };
+
+  StopTable() : size_(0), sizes_{} {}
+
+  // Registers a request. Returns true if it created a new stop and false if
+  // it was merged into an already pending one.
+  bool add(const Request& r) {
+    Kind kind = kindOf(r);
+    FloorSet& set = floors_[idx(kind)];
+    waiting_[idx(kind)][r.floor_].push_back(r);
+    if (set.test(r.floor_)) return false;
+    set.set(r.floor_);
+    size_++;
+    sizes_[idx(kind)]++;
+    return true;
+  }
+
+  // Number of distinct pending stops
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  // Number of pending stops of the given kind
+  size_t size(Kind kind) const { return sizes_[idx(kind)]; }
+
+  // Returns true if a stop of the given kind is pending at the floor
+  bool has(uint8_t floor, Kind kind) const { return floors_[idx(kind)].test(floor); }
+
+  // LOOK scheduling: the next stop of a car at the given location which is
+  // sweeping in the given direction. The sweep continues as long as there
+  // are stops ahead, turns around at the farthest hall call against the
+  // sweep direction, and only then reverses. floor is NONE if the table
+  // is empty.
+  Stop next(uint8_t location, Request::Direction direction) const {
+    const FloorSet& up = floors_[idx(Kind::UP)];
+    const FloorSet& down = floors_[idx(Kind::DOWN)];
+    const FloorSet& car = floors_[idx(Kind::CAR)];
+    int floor;
+
+    if (direction == Request::Direction::UP) {
+      if ((floor = (up | car).lowestFrom(location)) != FloorSet::NONE) return Stop{floor, Request::Direction::UP};
+      if ((floor = down.highestTo(FloorSet::MAX_FLOORS - 1)) >= location) return Stop{floor, Request::Direction::DOWN};
+      if ((floor = (down | car).highestTo(location)) != FloorSet::NONE) return Stop{floor, Request::Direction::DOWN};
+      if ((floor = up.lowestFrom(0)) != FloorSet::NONE) return Stop{floor, Request::Direction::UP};
+    } else {
+      if ((floor = (down | car).highestTo(location)) != FloorSet::NONE) return Stop{floor, Request::Direction::DOWN};
+      if ((floor = up.lowestFrom(0)) != FloorSet::NONE && floor <= location) return Stop{floor, Request::Direction::UP};
+      if ((floor = (up | car).lowestFrom(location)) != FloorSet::NONE) return Stop{floor, Request::Direction::UP};
+      if ((floor = down.highestTo(FloorSet::MAX_FLOORS - 1)) != FloorSet::NONE) return Stop{floor, Request::Direction::DOWN};
+    }
+    return Stop{FloorSet::NONE, direction};
+  }
+
+  // First request waiting for the stop which serve() would clear. The stop
+  // must be pending.
+  const Request& lead(uint8_t floor, Request::Direction direction) const {
+    const std::vector<Request>& car = waiting_[idx(Kind::CAR)][floor];
+    if (!car.empty()) return car.front();
+    return waiting_[idx((direction == Request::Direction::UP) ? Kind::UP : Kind::DOWN)][floor].front();
+  }
+
+  // Clears the car call and the hall call of the given direction at the floor
+  // and appends the requests which were waiting for them to served
+  void serve(uint8_t floor, Request::Direction direction, std::vector<Request>& served) {
+    take(floor, Kind::CAR, served);
+    take(floor, (direction == Request::Direction::UP) ? Kind::UP : Kind::DOWN, served);
+  }
+
+  // Kind of the stop which a request asks for
+  static Kind kindOf(const Request& r) {
+    if (r.cmd_ == Request::Command::GO) return Kind::CAR;
+    return (r.direction_ == Request::Direction::UP) ? Kind::UP : Kind::DOWN;
+  }
+
+private:
+  static size_t idx(Kind kind) { return static_cast<size_t>(kind); }
+
+  void take(uint8_t floor, Kind kind, std::vector<Request>& served) {
+    FloorSet& set = floors_[idx(kind)];
+    if (!set.test(floor)) return;
+    set.reset(floor);
+    size_--;
+    sizes_[idx(kind)]--;
+    std::vector<Request>& waiting = waiting_[idx(kind)][floor];
+    served.insert(served.end(), waiting.begin(), waiting.end());
+    waiting.clear();
+  }
+
+  FloorSet floors_[NUM_KINDS];
+  std::vector<Request> waiting_[NUM_KINDS][FloorSet::MAX_FLOORS];
+  size_t size_;
+  size_t sizes_[NUM_KINDS];
+};
+
+
+#endif /* D_STOP_TABLE_H */
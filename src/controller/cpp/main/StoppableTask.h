@@ -4,7 +4,8 @@
  *           https://thispointer.com/c11-how-to-stop-or-terminate-a-thread/
  * @date   27 July 2020
  * @version 0.1
- * @brief   Implements a C++11 stoppable thread class.
+ * @brief   Implements a C++11 stoppable thread class whose blocking waits
+ *          are woken up by a stop request.
  */
 
 #ifndef D_STOPPABLETASK_H
@@ -32,24 +33,26 @@
 #include <stdexcept>
 
 #include <chrono>
+#include <atomic>
+#include <mutex>
 
 
 
+// A stop request sets an atomic flag, so that polling it costs one load,
+// and runs the stop handlers registered by the task. A task which blocks
+// registers a handler waking its wait up (a condition variable, an eventfd),
+// so that the stop is noticed at once instead of after a timeout.
 class Stoppable
 {
 private:
-  std::promise<void> exitSignal;
-  std::future<void> futureObj;
+  std::atomic<bool> stopRequested_;
+  std::mutex stopMutex_;
+  std::vector<std::function<void ()>> stopHandlers_;
 public:
-  Stoppable(): futureObj(exitSignal.get_future()) {}
-  Stoppable(Stoppable && obj): exitSignal(std::move(obj.exitSignal)), futureObj(std::move(obj.futureObj)) {}
+  Stoppable(): stopRequested_(false) {}
 
-  Stoppable & operator=(Stoppable && obj)
-  {
-    exitSignal = std::move(obj.exitSignal);
-    futureObj = std::move(obj.futureObj);
-    return *this;
-  }
+  Stoppable(const Stoppable&) = delete;
+  Stoppable & operator=(const Stoppable&) = delete;
 
   virtual ~Stoppable() {  }
 
@@ -65,19 +68,39 @@ public:
 
 
   //Checks if thread is requested to stop
-  bool stopRequested()
+  bool stopRequested() const
   {
-    // checks if value in future object is available
-    if (futureObj.wait_for(std::chrono::milliseconds(0)) == std::future_status::timeout)
-      return false;
-    return true;
+    return stopRequested_.load(std::memory_order_acquire);
   }
 
 
-  // Request the thread to stop by setting value in promise object
+  // Request the thread to stop by setting the flag and waking it up. Further
+  // requests have no effect until the task has been re-armed.
   void stop()
   {
-    exitSignal.set_value();
+    std::lock_guard<std::mutex> lock(stopMutex_);
+    if (stopRequested_.exchange(true, std::memory_order_seq_cst))
+      return;
+    for (auto& handler : stopHandlers_)
+      handler();
+  }
+
+
+  // Registers a handler which is called on every stop request. The handler
+  // must not block and must not call stop() itself.
+  void onStop(std::function<void ()> handler)
+  {
+    std::lock_guard<std::mutex> lock(stopMutex_);
+    stopHandlers_.push_back(std::move(handler));
+  }
+
+
+  // Re-arms a stopped task so that it can be run again. Must not be called
+  // while the task is running.
+  void reset()
+  {
+    std::lock_guard<std::mutex> lock(stopMutex_);
+    stopRequested_.store(false, std::memory_order_release);
   }
 };
 
@@ -0,0 +1,259 @@
+/*
+ * @file   TimerWheel.h
+ * @author Armin Zare Zadeh, ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   Hierarchical timer wheel. It is being used for the timed
+ *          events of the cars (floor travel, door dwell) and of the
+ *          transport layer (connection idle timeouts).
+ */
+
+#ifndef D_TIMER_WHEEL_H
+#define D_TIMER_WHEEL_H
+
+#include "NonCopyable.h"
+
+#include <functional>
+#include <limits>
+#include <cstddef>
+#include <cstdint>
+
+
+
+// Four levels of 64 slots. A timer is linked into the slot of the level
+// whose range covers its distance from the current tick, and it is cascaded
+// down to a finer level when the wheel reaches its slot. Scheduling and
+// cancelling unlink/link a node of an intrusive list, so both take constant
+// time; advancing walks at most one slot boundary per 64 ticks, and the
+// occupancy bitmaps of the levels give the next expiry without scanning.
+// A wheel is owned by one thread and is not thread-safe.
+class TimerWheel : noncopyable {
+public:
+  static const int64_t NEVER = std::numeric_limits<int64_t>::max();
+
+  // Timer node owned by the user. The callback is assigned once, so that
+  // re-arming a timer never allocates.
+  class Timer : noncopyable {
+  public:
+    explicit Timer(std::function<void ()> callback) : callback_(std::move(callback)) {}
+
+    ~Timer() {
+      if (wheel_ != nullptr) wheel_->cancel(*this);
+    }
+
+    // True while the timer is scheduled
+    bool pending() const { return wheel_ != nullptr; }
+
+    // Expiry time of the timer when it was last scheduled
+    int64_t expiry_ms() const { return expiry_ms_; }
+
+  private:
+    friend class TimerWheel;
+
+    std::function<void ()> callback_;
+    TimerWheel* wheel_ = nullptr;
+    Timer* prev_ = nullptr;
+    Timer* next_ = nullptr;
+    int64_t expiry_ms_ = 0;
+    int64_t tick_ = 0;
+    int level_ = 0;   // EXPIRED_LEVEL for the list of expired timers
+    int slot_ = 0;
+  };
+
+  // ctor
+  TimerWheel(int64_t now_ms, int64_t tick_ms = 1) : tick_ms_(tick_ms), now_(ticks(now_ms)), size_(0) {
+    for (int l = 0; l < LEVELS; l++) occupied_[l] = 0;
+  }
+
+  // dtor; pending timers are released without being fired
+  ~TimerWheel() {
+    for (int l = 0; l < LEVELS; l++)
+      for (int s = 0; s < SLOTS; s++)
+        release(slots_[l][s]);
+    release(expired_);
+  }
+
+  // Number of pending timers
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  // Schedules the timer at the given time; a pending timer is re-armed
+  void schedule(Timer& timer, int64_t expiry_ms) {
+    if (timer.wheel_ != nullptr) timer.wheel_->cancel(timer);
+    timer.wheel_ = this;
+    timer.expiry_ms_ = expiry_ms;
+    timer.tick_ = ticks(expiry_ms);
+    size_++;
+    place(timer);
+  }
+
+  // Cancels the timer if it is pending
+  void cancel(Timer& timer) {
+    if (timer.wheel_ != this) return;
+    List& list = (timer.level_ == EXPIRED_LEVEL) ? expired_ : slots_[timer.level_][timer.slot_];
+    unlink(list, timer);
+    if (timer.level_ != EXPIRED_LEVEL && list.head == nullptr)
+      occupied_[timer.level_] &= ~(uint64_t(1) << timer.slot_);
+    timer.wheel_ = nullptr;
+    size_--;
+  }
+
+  // Advances the wheel to the given time and fires every timer which has
+  // expired, in the order of their expiry ticks and, within one tick, in the
+  // order they were scheduled. Returns the number of fired timers.
+  size_t advance(int64_t now_ms) {
+    int64_t target = now_ms / tick_ms_;
+    size_t fired = fireExpired();
+    if (size_ == 0 && now_ < target) now_ = target;
+    while (now_ < target) {
+      // Jump to the next occupied level 0 slot or to the next slot boundary,
+      // where the coarser levels are cascaded
+      int64_t boundary = (now_ | (SLOTS - 1)) + 1;
+      int64_t next = boundary;
+      uint64_t rest = occupied_[0] & (~uint64_t(0) << ((now_ + 1) & (SLOTS - 1)));
+      if ((now_ + 1) != boundary && rest != 0)
+        next = (now_ & ~int64_t(SLOTS - 1)) + __builtin_ctzll(rest);
+      now_ = (next < target) ? next : target;
+
+      if (now_ == boundary) cascade();
+      int s = static_cast<int>(now_ & (SLOTS - 1));
+      if (occupied_[0] & (uint64_t(1) << s)) {
+        List& list = slots_[0][s];
+        while (list.head != nullptr) {
+          Timer& timer = *list.head;
+          unlink(list, timer);
+          timer.level_ = EXPIRED_LEVEL;
+          link(expired_, timer);
+        }
+        occupied_[0] &= ~(uint64_t(1) << s);
+      }
+      fired += fireExpired();
+    }
+    return fired;
+  }
+
+  // Earliest time at which advance() may have work to do, or NEVER. For
+  // timers on the coarser levels it is the start of their slot, which is a
+  // lower bound of their expiry; waking up then cascades them.
+  int64_t next_expiry_ms() const {
+    if (expired_.head != nullptr) return now_ * tick_ms_;
+    int64_t best = NEVER;
+    for (int l = 0; l < LEVELS; l++) {
+      if (occupied_[l] == 0) continue;
+      int shift = l * BITS;
+      int cur = static_cast<int>((now_ >> shift) & (SLOTS - 1));
+      uint64_t rotated = (occupied_[l] >> cur) | ((cur == 0) ? 0 : (occupied_[l] << (SLOTS - cur)));
+      // The slot at distance 0 has already been walked through in the
+      // current round, so its timers belong to the next round
+      int64_t distance = ((rotated & ~uint64_t(1)) != 0) ? __builtin_ctzll(rotated & ~uint64_t(1)) : SLOTS;
+      int64_t tick = (((now_ >> shift) + distance) << shift);
+      if (tick * tick_ms_ < best) best = tick * tick_ms_;
+    }
+    return best;
+  }
+
+private:
+  static const int BITS = 6;
+  static const int SLOTS = 1 << BITS;
+  static const int LEVELS = 4;
+  static const int EXPIRED_LEVEL = -1;
+
+  struct List {
+    Timer* head = nullptr;
+    Timer* tail = nullptr;
+  };
+
+  int64_t ticks(int64_t time_ms) const {
+    // Round up, so that a timer never fires before its expiry time
+    return (time_ms + tick_ms_ - 1) / tick_ms_;
+  }
+
+  static void link(List& list, Timer& timer) {
+    timer.prev_ = list.tail;
+    timer.next_ = nullptr;
+    if (list.tail != nullptr) list.tail->next_ = &timer;
+    else list.head = &timer;
+    list.tail = &timer;
+  }
+
+  static void unlink(List& list, Timer& timer) {
+    if (timer.prev_ != nullptr) timer.prev_->next_ = timer.next_;
+    else list.head = timer.next_;
+    if (timer.next_ != nullptr) timer.next_->prev_ = timer.prev_;
+    else list.tail = timer.prev_;
+    timer.prev_ = timer.next_ = nullptr;
+  }
+
+  // Links the timer into the level covering its distance from now
+  void place(Timer& timer) {
+    int64_t delta = timer.tick_ - now_;
+    if (delta <= 0) {
+      timer.level_ = EXPIRED_LEVEL;
+      link(expired_, timer);
+      return;
+    }
+    int level = 0;
+    while (level < LEVELS - 1 && delta >= (int64_t(1) << ((level + 1) * BITS)))
+      level++;
+    // Timers beyond the range of the wheel wait in the farthest slot and
+    // are placed again when it is cascaded
+    int64_t tick = timer.tick_;
+    int64_t range = int64_t(1) << (LEVELS * BITS);
+    if (delta >= range) tick = now_ + range - 1;
+    int slot = static_cast<int>((tick >> (level * BITS)) & (SLOTS - 1));
+    timer.level_ = level;
+    timer.slot_ = slot;
+    link(slots_[level][slot], timer);
+    occupied_[level] |= uint64_t(1) << slot;
+  }
+
+  // Moves the timers of the current slot of each coarser level, whose
+  // boundary has just been reached, down to the finer levels
+  void cascade() {
+    for (int l = 1; l < LEVELS; l++) {
+      int shift = l * BITS;
+      int s = static_cast<int>((now_ >> shift) & (SLOTS - 1));
+      List list = slots_[l][s];
+      slots_[l][s] = List();
+      occupied_[l] &= ~(uint64_t(1) << s);
+      while (list.head != nullptr) {
+        Timer& timer = *list.head;
+        unlink(list, timer);
+        place(timer);
+      }
+      // Only continue while the finer level has wrapped as well
+      if (((now_ >> shift) & (SLOTS - 1)) != 0) break;
+    }
+  }
+
+  size_t fireExpired() {
+    size_t fired = 0;
+    while (expired_.head != nullptr) {
+      Timer& timer = *expired_.head;
+      unlink(expired_, timer);
+      timer.wheel_ = nullptr;
+      size_--;
+      fired++;
+      timer.callback_();
+    }
+    return fired;
+  }
+
+  void release(List& list) {
+    while (list.head != nullptr) {
+      Timer& timer = *list.head;
+      unlink(list, timer);
+      timer.wheel_ = nullptr;
+    }
+  }
+
+  const int64_t tick_ms_;
+  int64_t now_;   // current tick
+  size_t size_;
+  uint64_t occupied_[LEVELS];
+  List slots_[LEVELS][SLOTS];
+  List expired_;
+};
+
+
+#endif /* D_TIMER_WHEEL_H */
@@ -0,0 +1,350 @@
+/*
+ * @file   Trace.h
+ * @author Armin Zare Zadeh, ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   Binary event trace of the elevator system. Every thread
+ *          records compact events into a ring of its own inside a
+ *          memory-mapped trace file, which survives a crash of the
+ *          process. The reader turns a trace file into a Chrome /
+ *          Perfetto timeline.
+ */
+
+#ifndef D_TRACE_H
+#define D_TRACE_H
+
+#include "NonCopyable.h"
+
+#ifndef __WIN32__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+
+// Traced event: 16 bytes with a nanosecond time stamp relative to the
+// opening of the trace. The meaning of the fields depends on the type.
+struct TraceEvent {
+  enum class Type : uint8_t {
+    ACCEPTED = 1,  // request assigned to a car: node, msg id, floor, command
+    QUEUED,        // request taken into the stop table: node, msg id, floor, stop kind
+    DEPART,        // car starts moving: floor of its next stop, direction
+    DIRECTION,     // car changes its sweep direction: floor, new direction
+    FLOOR,         // car passes or reaches a floor: floor, direction
+    DOOR_OPEN,     // car stops and opens the doors: floor, direction
+    DOOR_CLOSE,    // doors close: floor
+    ACK,           // frame acknowledged: node, msg id
+    NAK,           // frame rejected: node, msg id
+    SEND           // status report queued for a requester: node, msg id, car, floor, state
+  };
+
+  uint64_t ns;
+  Type type;
+  uint8_t car;
+  uint16_t node;
+  uint16_t msgId;
+  uint8_t floor;
+  uint8_t arg;
+};
+
+static_assert(sizeof(TraceEvent) == 16, "TraceEvent must be 16 bytes");
+
+
+
+// Trace file layout: a file header, the headers of all thread slots and
+// then the event ring of every slot. A thread claims a slot on its first
+// event and is the only writer of its ring, so recording an event is a
+// clock read and a few plain stores; the ring overwrites its oldest events.
+class Tracer : noncopyable {
+public:
+  static const uint32_t MAGIC = 0x43525445;   // "ETRC"
+  static const uint32_t VERSION = 1;
+  static const uint32_t MAX_THREADS = 64;
+  static const uint32_t RING_EVENTS = 16384;  // power of two
+
+  struct FileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t maxThreads;
+    uint32_t ringEvents;
+    int64_t wallNs;                   // wall clock time at the opening
+    std::atomic<uint32_t> threads;    // claimed slots
+    std::atomic<uint32_t> dropped;    // events of threads without a slot
+    uint8_t reserved[32];
+  };
+
+  struct SlotHeader {
+    std::atomic<uint64_t> head;       // events ever recorded into the ring
+    uint64_t tid;                     // system thread id of the writer
+    uint8_t reserved[48];
+  };
+
+  static const size_t SLOTS_OFFSET = sizeof(FileHeader);
+  static const size_t RINGS_OFFSET = SLOTS_OFFSET + MAX_THREADS * sizeof(SlotHeader);
+  static const size_t RING_BYTES = RING_EVENTS * sizeof(TraceEvent);
+  static const size_t FILE_BYTES = RINGS_OFFSET + MAX_THREADS * RING_BYTES;
+
+private:
+  std::atomic<bool> enabled_;
+  std::atomic<uint32_t> generation_;  // invalidates the slots of a former file
+  uint8_t* base_;
+  std::chrono::steady_clock::time_point start_;
+#ifndef __WIN32__
+  int fd_;
+#endif
+
+  // Slot of the calling thread in the current trace file
+  struct LocalSlot {
+    uint32_t generation = 0;
+    SlotHeader* header = nullptr;
+    TraceEvent* ring = nullptr;
+  };
+
+  Tracer() : enabled_(false), generation_(0), base_(nullptr) {
+#ifndef __WIN32__
+    fd_ = -1;
+#endif
+  }
+
+public:
+  ~Tracer() {
+    close();
+  }
+
+  static Tracer& instance() {
+    static Tracer tracer;
+    return tracer;
+  }
+
+  // Creates the trace file and starts tracing. The trace of a former run
+  // at the same path, e.g. one which has crashed, is kept as <path>.1 and
+  // replaces an older one there. Must not be called while another trace is
+  // open.
+  void open(const std::string& path) {
+#ifndef __WIN32__
+    if (base_ != nullptr)
+      throw std::runtime_error("Trace already open");
+    if (::rename(path.c_str(), (path + ".1").c_str()) == -1 && errno != ENOENT)
+      throw std::runtime_error("Trace " + path + ": " + strerror(errno));
+    int fd = ::open(path.c_str(), O_CREAT | O_TRUNC | O_RDWR | O_CLOEXEC, 0644);
+    if (fd == -1)
+      throw std::runtime_error("Trace " + path + ": " + strerror(errno));
+    void* base = MAP_FAILED;
+    if (ftruncate(fd, FILE_BYTES) == 0)
+      base = mmap(nullptr, FILE_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+      std::string error = strerror(errno);
+      ::close(fd);
+      throw std::runtime_error("Trace " + path + ": " + error);
+    }
+
+    fd_ = fd;
+    base_ = static_cast<uint8_t*>(base);
+    start_ = std::chrono::steady_clock::now();
+    FileHeader* header = reinterpret_cast<FileHeader*>(base_);
+    header->magic = MAGIC;
+    header->version = VERSION;
+    header->maxThreads = MAX_THREADS;
+    header->ringEvents = RING_EVENTS;
+    header->wallNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    header->threads.store(0, std::memory_order_relaxed);
+    header->dropped.store(0, std::memory_order_relaxed);
+    generation_.fetch_add(1, std::memory_order_relaxed);
+    enabled_.store(true, std::memory_order_release);
+#else
+    (void)path;
+    throw std::runtime_error("Tracing is not supported on this platform");
+#endif
+  }
+
+  // Stops tracing and writes the trace file back. Must not race with the
+  // recording threads, e.g. it is called after they have been joined.
+  void close() {
+#ifndef __WIN32__
+    enabled_.store(false, std::memory_order_release);
+    if (base_ == nullptr) return;
+    msync(base_, FILE_BYTES, MS_SYNC);
+    munmap(base_, FILE_BYTES);
+    ::close(fd_);
+    base_ = nullptr;
+    fd_ = -1;
+#endif
+  }
+
+  bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+  // Records an event of the calling thread; a single load while tracing
+  // is off
+  static void event(TraceEvent::Type type, uint8_t car, uint16_t node, uint16_t msgId, uint8_t floor, uint8_t arg) {
+    Tracer& tracer = instance();
+    if (tracer.enabled())
+      tracer.record(type, car, node, msgId, floor, arg);
+  }
+
+private:
+  void record(TraceEvent::Type type, uint8_t car, uint16_t node, uint16_t msgId, uint8_t floor, uint8_t arg) {
+    LocalSlot& slot = localSlot();
+    if (slot.header == nullptr)
+      return;
+
+    uint64_t ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_).count());
+    uint64_t head = slot.header->head.load(std::memory_order_relaxed);
+    TraceEvent& e = slot.ring[head & (RING_EVENTS - 1)];
+    e.ns = ns;
+    e.type = type;
+    e.car = car;
+    e.node = node;
+    e.msgId = msgId;
+    e.floor = floor;
+    e.arg = arg;
+    slot.header->head.store(head + 1, std::memory_order_release);
+  }
+
+  // Claims a slot of the current trace file for the calling thread
+  LocalSlot& localSlot() {
+    static thread_local LocalSlot slot;
+    uint32_t generation = generation_.load(std::memory_order_relaxed);
+    if (slot.generation == generation)
+      return slot;
+
+    slot.generation = generation;
+    slot.header = nullptr;
+    FileHeader* header = reinterpret_cast<FileHeader*>(base_);
+    uint32_t index = header->threads.fetch_add(1, std::memory_order_relaxed);
+    if (index >= MAX_THREADS) {
+      header->dropped.fetch_add(1, std::memory_order_relaxed);
+      return slot;
+    }
+    slot.header = reinterpret_cast<SlotHeader*>(base_ + SLOTS_OFFSET) + index;
+    slot.ring = reinterpret_cast<TraceEvent*>(base_ + RINGS_OFFSET + index * RING_BYTES);
+#ifndef __WIN32__
+    slot.header->tid = static_cast<uint64_t>(syscall(SYS_gettid));
+#endif
+    slot.header->head.store(0, std::memory_order_relaxed);
+    return slot;
+  }
+};
+
+
+
+// Offline reader of a trace file. The events left in the rings of all
+// threads are merged by their time stamps.
+class TraceReader : noncopyable {
+public:
+  struct Record {
+    uint64_t tid;
+    TraceEvent event;
+  };
+
+private:
+  int64_t wallNs_;
+  std::vector<Record> records_;
+
+public:
+  // ctor; throws if the file is not a trace
+  explicit TraceReader(const std::string& path) : wallNs_(0) {
+    std::ifstream in(path, std::ios::binary);
+    std::vector<char> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (data.size() < Tracer::RINGS_OFFSET)
+      throw std::runtime_error("Not a trace file: " + path);
+
+    const Tracer::FileHeader* header = reinterpret_cast<const Tracer::FileHeader*>(data.data());
+    if (header->magic != Tracer::MAGIC || header->version != Tracer::VERSION ||
+        header->maxThreads != Tracer::MAX_THREADS || header->ringEvents != Tracer::RING_EVENTS ||
+        data.size() < Tracer::FILE_BYTES)
+      throw std::runtime_error("Not a trace file: " + path);
+    wallNs_ = header->wallNs;
+
+    uint32_t threads = header->threads.load(std::memory_order_relaxed);
+    if (threads > Tracer::MAX_THREADS) threads = Tracer::MAX_THREADS;
+    for (uint32_t i = 0; i < threads; i++) {
+      const Tracer::SlotHeader* slot = reinterpret_cast<const Tracer::SlotHeader*>(data.data() + Tracer::SLOTS_OFFSET) + i;
+      const TraceEvent* ring = reinterpret_cast<const TraceEvent*>(data.data() + Tracer::RINGS_OFFSET + i * Tracer::RING_BYTES);
+      uint64_t head = slot->head.load(std::memory_order_relaxed);
+      uint64_t first = (head > Tracer::RING_EVENTS) ? head - Tracer::RING_EVENTS : 0;
+      for (uint64_t n = first; n < head; n++)
+        records_.push_back(Record{slot->tid, ring[n & (Tracer::RING_EVENTS - 1)]});
+    }
+    std::stable_sort(records_.begin(), records_.end(), [](const Record& a, const Record& b) { return a.event.ns < b.event.ns; });
+  }
+
+  // Events of all threads in the order of their time stamps
+  const std::vector<Record>& records() const { return records_; }
+
+  // Wall clock time of the start of the trace in nanoseconds
+  int64_t wallNs() const { return wallNs_; }
+
+  static const char* name(TraceEvent::Type type) {
+    switch (type) {
+      case TraceEvent::Type::ACCEPTED: return "accepted";
+      case TraceEvent::Type::QUEUED: return "queued";
+      case TraceEvent::Type::DEPART: return "depart";
+      case TraceEvent::Type::DIRECTION: return "direction";
+      case TraceEvent::Type::FLOOR: return "floor";
+      case TraceEvent::Type::DOOR_OPEN: return "door open";
+      case TraceEvent::Type::DOOR_CLOSE: return "door close";
+      case TraceEvent::Type::ACK: return "ack";
+      case TraceEvent::Type::NAK: return "nak";
+      case TraceEvent::Type::SEND: return "send";
+      default: return "unknown";
+    }
+  }
+
+  // Writes the trace in the Chrome trace event format, which is opened by
+  // chrome://tracing and ui.perfetto.dev. Every thread gets a track of
+  // instant events; every car gets a track of slices for its trips
+  // ("moving") and stops ("doors open").
+  void writeChromeJson(std::ostream& out) const {
+    const int THREADS_PID = 1;
+    const int CARS_PID = 2;
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    out << "{\"ph\":\"M\",\"pid\":" << THREADS_PID << ",\"name\":\"process_name\",\"args\":{\"name\":\"threads\"}},\n";
+    out << "{\"ph\":\"M\",\"pid\":" << CARS_PID << ",\"name\":\"process_name\",\"args\":{\"name\":\"cars\"}}";
+
+    // Open slice per car: 0 none, otherwise the type which opened it
+    std::vector<TraceEvent::Type> open(256, static_cast<TraceEvent::Type>(0));
+    for (const auto& r : records_) {
+      const TraceEvent& e = r.event;
+      double us = static_cast<double>(e.ns) / 1000.0;
+      out << ",\n{\"ph\":\"i\",\"s\":\"t\",\"pid\":" << THREADS_PID << ",\"tid\":" << r.tid
+          << ",\"ts\":" << std::fixed << us << ",\"name\":\"" << name(e.type) << "\",\"args\":{"
+          << "\"car\":" << static_cast<int>(e.car) << ",\"node\":" << e.node << ",\"msg_id\":" << e.msgId
+          << ",\"floor\":" << static_cast<int>(e.floor) << ",\"arg\":" << static_cast<int>(e.arg) << "}}";
+
+      // Trips and stops of the cars
+      TraceEvent::Type slice = static_cast<TraceEvent::Type>(0);
+      if (e.type == TraceEvent::Type::DEPART) slice = TraceEvent::Type::DEPART;
+      else if (e.type == TraceEvent::Type::DOOR_OPEN) slice = TraceEvent::Type::DOOR_OPEN;
+      else if (e.type != TraceEvent::Type::DOOR_CLOSE) continue;
+
+      if (open[e.car] != static_cast<TraceEvent::Type>(0))
+        out << ",\n{\"ph\":\"E\",\"pid\":" << CARS_PID << ",\"tid\":" << static_cast<int>(e.car) << ",\"ts\":" << us << "}";
+      open[e.car] = slice;
+      if (slice != static_cast<TraceEvent::Type>(0))
+        out << ",\n{\"ph\":\"B\",\"pid\":" << CARS_PID << ",\"tid\":" << static_cast<int>(e.car) << ",\"ts\":" << us
+            << ",\"name\":\"" << ((slice == TraceEvent::Type::DEPART) ? "moving" : "doors open")
+            << "\",\"args\":{\"floor\":" << static_cast<int>(e.floor) << "}}";
+    }
+    out << "\n]}\n";
+    out.unsetf(std::ios::floatfield);
+  }
+};
+
+
+#endif /* D_TRACE_H */
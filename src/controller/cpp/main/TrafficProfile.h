@@ -0,0 +1,116 @@
+/*
+ * @file   TrafficProfile.h
+ * @author Armin Zare Zadeh, ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   Passenger traffic profiles of a building: Poisson arrivals
+ *          with the origin and destination mix of the up-peak, down-peak,
+ *          lunch and interfloor traffic. They are being used by the load
+ *          generator.
+ */
+
+#ifndef D_TRAFFIC_PROFILE_H
+#define D_TRAFFIC_PROFILE_H
+
+#include "Request.h"
+
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+
+
+// Passengers arrive as a Poisson process with the given rate. A passenger
+// is either incoming (from the lobby, floor 0, to an upper floor), outgoing
+// (from an upper floor to the lobby) or interfloor (between two upper
+// floors); the profile sets the share of each, and the upper floors are
+// picked uniformly.
+class TrafficProfile {
+public:
+  enum class Kind : uint8_t { UP_PEAK = 0, DOWN_PEAK, LUNCH, INTERFLOOR };
+
+  struct Passenger {
+    uint8_t origin;
+    uint8_t destination;
+
+    Request::Direction direction() const {
+      return (destination > origin) ? Request::Direction::UP : Request::Direction::DOWN;
+    }
+  };
+
+private:
+  Kind kind_;
+  uint8_t floors_;
+  std::mt19937_64 rng_;
+  std::exponential_distribution<double> gap_;
+  std::uniform_real_distribution<double> share_;
+  std::uniform_int_distribution<int> upper_;
+
+public:
+  // Fewest floors with a lobby and at least two upper floors
+  static const uint8_t MIN_FLOORS = 3;
+
+  // ctor; the rate is given in passengers per second. The arguments are
+  // checked before the distributions are built from them.
+  TrafficProfile(Kind kind, uint8_t floors, double rate, uint64_t seed) :
+      kind_(kind),
+      floors_(checkFloors(floors)),
+      rng_(seed),
+      gap_(checkRate(rate) / 1e9),
+      share_(0.0, 1.0),
+      upper_(1, floors_ - 1) {}
+
+  static uint8_t checkFloors(uint8_t floors) {
+    if (floors < MIN_FLOORS)
+      throw std::invalid_argument("Too few floors for a traffic profile: " + std::to_string(floors));
+    return floors;
+  }
+
+  static double checkRate(double rate) {
+    if (!(rate > 0.0))
+      throw std::invalid_argument("Illegal passenger rate: " + std::to_string(rate));
+    return rate;
+  }
+
+  static Kind parse(const std::string& name) {
+    if (name == "up-peak") return Kind::UP_PEAK;
+    if (name == "down-peak") return Kind::DOWN_PEAK;
+    if (name == "lunch") return Kind::LUNCH;
+    if (name == "interfloor") return Kind::INTERFLOOR;
+    throw std::invalid_argument("Unknown traffic profile: " + name);
+  }
+
+  // Time until the next passenger arrives, in nanoseconds
+  uint64_t nextGapNs() {
+    return static_cast<uint64_t>(gap_(rng_)) + 1;
+  }
+
+  // Origin and destination of the next passenger
+  Passenger next() {
+    // Shares of incoming and outgoing passengers; the rest is interfloor
+    static const double SHARES[4][2] = {
+      {0.85, 0.05},   // up-peak
+      {0.05, 0.85},   // down-peak
+      {0.45, 0.45},   // lunch
+      {0.0, 0.0}      // interfloor
+    };
+    const double* shares = SHARES[static_cast<size_t>(kind_)];
+
+    double share = share_(rng_);
+    if (share < shares[0])
+      return Passenger{0, static_cast<uint8_t>(upper_(rng_))};
+    if (share < shares[0] + shares[1])
+      return Passenger{static_cast<uint8_t>(upper_(rng_)), 0};
+
+    uint8_t origin = static_cast<uint8_t>(upper_(rng_));
+    uint8_t destination;
+    do {
+      destination = static_cast<uint8_t>(upper_(rng_));
+    } while (destination == origin);
+    return Passenger{origin, destination};
+  }
+};
+
+
+#endif /* D_TRAFFIC_PROFILE_H */
@@ -0,0 +1,81 @@
+/*
+ * @file   Transport.h
+ * @author Armin Zare Zadeh, ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   Transport abstraction of the network protocol handler. The
+ *          TCP/IP transport socket serves the real requester nodes, while
+ *          the in-process loopback transport connects simulated ones.
+ */
+
+#ifndef D_TRANSPORT_H
+#define D_TRANSPORT_H
+
+#include "NonCopyable.h"
+#include "ByteRing.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+
+namespace Net {
+
+// Connection of a requester node as seen by the protocol handler. The
+// received bytes are collected in the receive buffer, where they are cut
+// into frames, and the frames to send are queued without blocking.
+class Connection : noncopyable {
+public:
+  virtual ~Connection() {}
+
+  // Number identifying the connection among the open ones of its
+  // transport; the file descriptor of a socket
+  virtual int fileDescriptor() const = 0;
+
+  // Closes the connection; the close handler of the transport is called
+  virtual void close() = 0;
+
+  // Queues a frame for transmission. A droppable frame (a status report)
+  // may be lost in favour of newer frames when the peer does not keep up.
+  virtual void write(const uint8_t* data, size_t len, bool droppable = false) = 0;
+
+  // Queues a frame which is shared with other connections
+  virtual void write(std::shared_ptr<const std::vector<uint8_t>> shared, bool droppable = false) = 0;
+
+  // Moves the pending bytes into the receive buffer. Returns false if the
+  // buffer has filled up first; the caller has to consume complete frames
+  // and call it again.
+  virtual bool receive() = 0;
+
+  // Receive buffer holding the bytes of incomplete frames between reads
+  virtual ByteRing& rxBuffer() = 0;
+};
+
+
+// Interface of a transport. It accepts the connections of the requester
+// nodes and calls the handlers on their events, from the thread running
+// listen() unless the transport documents otherwise.
+class Transport : noncopyable {
+public:
+  using Handler = std::function<void (std::weak_ptr<Connection> connection)>;
+
+  virtual ~Transport() {}
+
+  // Handlers of a new connection, of received bytes and of a closed
+  // connection; they are set before listening starts
+  virtual void onAccept(Handler handler) = 0;
+  virtual void onRead(Handler handler) = 0;
+  virtual void onClose(Handler handler) = 0;
+
+  // Serves the connections until the stop request holds
+  virtual void listen(std::function<bool ()> stopRequested) = 0;
+
+  // Wakes the listening thread up, so that it notices a stop request at
+  // once; a transport which polls its stop request needs none
+  virtual void interrupt() {}
+};
+
+}
+
+#endif /* D_TRANSPORT_H */
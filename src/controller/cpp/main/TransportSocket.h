@@ -7,8 +7,8 @@
  * @brief   A TCP/IP Transport Socket implementation.
  */
 
-// Note: This transport class has been built with mingw-w64 compiler on Windows 10.
-// The Linux implementation is incomplete and has not been tested yet.
+// Note: This transport class has been built with mingw-w64 compiler on Windows 10,
+// where it runs a select() loop. On Linux it runs an edge-triggered epoll reactor.
 
 #ifndef D_TRANSPORT_SOCKET_H
 #define D_TRANSPORT_SOCKET_H
@@ -28,21 +28,37 @@
 #include <arpa/inet.h>
 #include <netinet/in.h>
 # include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/uio.h>
+#include <fcntl.h>
 #endif
 
 
 #include <unistd.h>
 
 #include <algorithm>
-#include <future>
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <limits>
 
 #include <functional>
 #include <memory>
 #include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <deque>
 #include <vector>
+#include <unordered_map>
+
+#include "Clock.h"
+#include "TimerWheel.h"
+#include "ByteRing.h"
+#include "Transport.h"
+#include "Logger.h"
+#include "Metrics.h"
 
 
 namespace Net {
@@ -51,10 +67,66 @@ namespace Net {
 #define DEFAULT_PORT "8080"
 
 
-class TransportSocket
+// I/O worker thread of the transport socket. The tasks posted to one worker
+// are run one after another in the order they were posted.
+class IoWorker
 {
 public:
-  class ClientSocket
+  IoWorker() : _thread( [this] () { run(); } ) {}
+
+
+  // The pending tasks are run before the thread exits
+  ~IoWorker() {
+    {
+      std::lock_guard<std::mutex> lock( _mutex );
+      _stop = true;
+    }
+    _cv.notify_one();
+    _thread.join();
+  }
+
+
+  IoWorker( const IoWorker& )            = delete;
+  IoWorker& operator=( const IoWorker& ) = delete;
+
+
+  void post( std::function<void ()> task ) {
+    {
+      std::lock_guard<std::mutex> lock( _mutex );
+      _tasks.push_back( std::move( task ) );
+    }
+    _cv.notify_one();
+  }
+
+private:
+  void run() {
+    std::unique_lock<std::mutex> lock( _mutex );
+    while( 1 )
+    {
+      _cv.wait( lock, [this] () -> bool { return _stop || !_tasks.empty(); } );
+      if( _tasks.empty() )
+        return;
+
+      std::function<void ()> task = std::move( _tasks.front() );
+      _tasks.pop_front();
+      lock.unlock();
+      task();
+      lock.lock();
+    }
+  }
+
+  std::mutex _mutex;
+  std::condition_variable _cv;
+  std::deque<std::function<void ()>> _tasks;
+  bool _stop = false;
+  std::thread _thread;
+};
+
+
+class TransportSocket : public Transport
+{
+public:
+  class ClientSocket : public Connection
   {
   public:
     ClientSocket(int fileDescriptor, TransportSocket& server) :
@@ -65,85 +137,277 @@ public:
     ~ClientSocket() {}
 
 
-    int fileDescriptor() const {
+    int fileDescriptor() const override {
       return _fileDescriptor;
     }
 
 
-    void close() {
+    void close() override {
       _server.close(_fileDescriptor);
     }
 
 
-    void write(const std::vector<uint8_t>& data) {
-    #ifndef __WIN32__
-      auto result = send( _fileDescriptor,
-                          reinterpret_cast<const void*>( &data[0] ),
-                          data.size(),
-                          0 );
-    #else
-      auto result = send( _fileDescriptor,
-                          reinterpret_cast<const char*>( &data[0] ),
-                          data.size(),
-                          0 );
-    #endif
+    // Queues a frame for transmission; the frame is copied and sent by the
+    // listening thread, so the caller never blocks on the network. When the
+    // queue is full (a slow or stalled peer), the oldest queued droppable
+    // frame makes room: status reports are superseded by newer frames, while
+    // other frames are never reordered or displaced.
+    void write(const uint8_t* data, size_t len, bool droppable = false) override {
+      if (len > TX_FRAME_MAX)
+        throw std::invalid_argument("Frame too long for the send queue: " + std::to_string(len));
 
-      if(result == -1)
-        throw std::runtime_error(std::string(strerror(errno)));
+      bool schedule = false;
+      {
+        std::lock_guard<std::mutex> lock(_txMutex);
+        TxFrame* frame = reserve(droppable);
+        if (frame != nullptr) {
+          memcpy(frame->data, data, len);
+          frame->len = static_cast<uint8_t>(len);
+          schedule = markScheduled();
+        }
+      }
+      if (schedule)
+        requestFlush();
     }
 
 
-    std::vector<uint8_t> read() {
-      std::vector<uint8_t> message;
+    // Queues a frame which is shared with other connections, e.g. a
+    // published status sent to many subscribers. The queue keeps a
+    // reference to the encoded frame instead of a copy.
+    void write(std::shared_ptr<const std::vector<uint8_t>> shared, bool droppable = false) override {
+      bool schedule = false;
+      {
+        std::lock_guard<std::mutex> lock(_txMutex);
+        TxFrame* frame = reserve(droppable);
+        if (frame != nullptr) {
+          frame->shared = std::move(shared);
+          schedule = markScheduled();
+        }
+      }
+      if (schedule)
+        requestFlush();
+    }
 
-      char buffer[256] = { 0 };
-      ssize_t numBytes = 0;
-      std::cout << "read" << std::endl;
 
-#ifdef __WIN32__
-      // Set the socket I/O mode: In this case FIONBIO
-      // enables or disables the blocking mode for the
-      // socket based on the numerical value of iMode.
-      // If iMode = 0, blocking is enabled;
-      // If iMode != 0, non-blocking mode is enabled.
-      u_long iMode = 1;
-      ioctlsocket(_fileDescriptor, FIONBIO, &iMode);
-#endif
+    void write(const std::vector<uint8_t>& data) {
+      write(data.data(), data.size());
+    }
+
 
-      do {
+    // Listening thread side: sends the queued frames, batched into one
+    // gather write, until the queue is empty or the socket would block. In
+    // the latter case the next writable event continues. Returns false if
+    // the connection has failed.
+    bool flush() {
+      std::lock_guard<std::mutex> lock(_txMutex);
+      _txScheduled = false;
+
+      while (_txCount > 0) {
 #ifdef __WIN32__
-        numBytes = recv( _fileDescriptor, buffer, sizeof(buffer), 0 );
+        TxFrame& head = _txQueue[_txHead];
+        int result = send( _fileDescriptor,
+                           reinterpret_cast<const char*>( head.bytes() + _txOffset ),
+                           static_cast<int>( head.size() - _txOffset ),
+                           0 );
+        if (result == SOCKET_ERROR)
+          return WSAGetLastError() == WSAEWOULDBLOCK;
+        size_t sent = static_cast<size_t>(result);
 #else
-        numBytes = recv( _fileDescriptor, buffer, sizeof(buffer), MSG_DONTWAIT );
+        iovec iov[TX_BATCH];
+        size_t num = (_txCount < TX_BATCH) ? _txCount : TX_BATCH;
+        for (size_t i = 0; i < num; i++) {
+          TxFrame& frame = _txQueue[(_txHead + i) % TX_QUEUE_CAPACITY];
+          size_t offset = (i == 0) ? _txOffset : 0;
+          iov[i].iov_base = const_cast<uint8_t*>(frame.bytes()) + offset;
+          iov[i].iov_len = frame.size() - offset;
+        }
+
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = num;
+        ssize_t result = sendmsg( _fileDescriptor, &msg, MSG_NOSIGNAL | MSG_DONTWAIT );
+        if (result == -1) {
+          if (errno == EINTR)
+            continue;
+          return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        size_t sent = static_cast<size_t>(result);
 #endif
-//        buffer[numBytes]  = 0;
-        std::cout << "numBytes:" << numBytes << std::endl;
-        if (numBytes > 0) {
-          for (int i=0; i<numBytes; i++) { message.push_back(buffer[i]); }
+
+        // Release the frames which went out completely
+        while (sent > 0) {
+          TxFrame& head = _txQueue[_txHead];
+          size_t rest = head.size() - _txOffset;
+          if (sent < rest) {
+            _txOffset += sent;
+            break;
+          }
+          sent -= rest;
+          _txOffset = 0;
+          head.shared.reset();
+          _txHead = (_txHead + 1) % TX_QUEUE_CAPACITY;
+          _txCount--;
+        }
+      }
+      return true;
+    }
+
+
+    // Number of frames waiting in the send queue
+    size_t txQueued() {
+      std::lock_guard<std::mutex> lock(_txMutex);
+      return _txCount;
+    }
+
+
+    // Number of frames lost on a full send queue
+    uint64_t txDropped() const {
+      return _txDropped.load(std::memory_order_relaxed);
+    }
+
+
+    // Reads the pending bytes into the receive buffer until the socket would
+    // block or the buffer is full. Returns false if the buffer has filled up
+    // before the socket has been drained; the caller has to consume complete
+    // frames and call it again.
+    bool receive() override {
+      bool drained = true;
+      ssize_t numBytes = 0;
+      size_t total = 0;
+
+      while (true) {
+        size_t len = 0;
+        uint8_t* buffer = _rxBuffer.writePtr(len);
+        if (len == 0) {
+          drained = false;
+          break;
         }
-        else if (numBytes == 0)
-          std::cout << "Connection closing...\n";
-      } while (numBytes > 0);
 
 #ifdef __WIN32__
-      iMode = 0;
-      ioctlsocket(_fileDescriptor, FIONBIO, &iMode);
+        numBytes = recv( _fileDescriptor, reinterpret_cast<char*>(buffer), static_cast<int>(len), 0 );
+#else
+        numBytes = recv( _fileDescriptor, buffer, len, MSG_DONTWAIT );
 #endif
+        if (numBytes <= 0) {
+          if (numBytes == 0)
+            LOG_INFO("Connection closing...");
+          break;
+        }
+        _rxBuffer.commit(static_cast<size_t>(numBytes));
+        total += static_cast<size_t>(numBytes);
+      }
 
-      return message;
+      _server._bytesReceived->add(total);
+      return drained;
+    }
+
+
+    // Receive buffer holding the bytes of incomplete frames between reads.
+    // It is only touched by the thread running the read handler of this
+    // connection.
+    ByteRing& rxBuffer() override {
+      return _rxBuffer;
     }
 
 
     ClientSocket(const ClientSocket&)            = delete;
     ClientSocket& operator=(const ClientSocket&) = delete;
 
+    static const size_t RX_BUFFER_SIZE = 4096;
+    static const size_t TX_FRAME_MAX = 64;         // longest frame of the send queue
+    static const size_t TX_QUEUE_CAPACITY = 128;   // high-water mark in frames
+    static const size_t TX_BATCH = 32;             // frames per gather write
+
   private:
+    // Queued frame: either a private copy or a reference to a shared frame
+    struct TxFrame {
+      uint8_t data[TX_FRAME_MAX];
+      uint8_t len;
+      bool droppable;
+      std::shared_ptr<const std::vector<uint8_t>> shared;
+
+      const uint8_t* bytes() const { return shared ? shared->data() : data; }
+      size_t size() const { return shared ? shared->size() : len; }
+    };
+
+
+    // Appends a slot to the send queue; a full queue makes room by dropping
+    // its oldest droppable frame. Returns nullptr if the frame has to be
+    // dropped. Must be called with the send queue locked.
+    TxFrame* reserve(bool droppable) {
+      if (_txCount == TX_QUEUE_CAPACITY && !dropOldest()) {
+        _txDropped.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+      }
+
+      TxFrame& frame = _txQueue[(_txHead + _txCount) % TX_QUEUE_CAPACITY];
+      frame.droppable = droppable;
+      frame.shared.reset();
+      _txCount++;
+      return &frame;
+    }
+
+
+    // True if a flush has to be requested for the newly queued frame. Must
+    // be called with the send queue locked.
+    bool markScheduled() {
+      bool schedule = !_txScheduled;
+      _txScheduled = true;
+      return schedule;
+    }
+
+
+    void requestFlush() {
+#ifdef __WIN32__
+      // There is no wake-up for the select loop; the non-blocking send is
+      // done right away and the loop picks up what is left over
+      flush();
+#else
+      _server.scheduleFlush(_fileDescriptor);
+#endif
+    }
+
+    // Makes room in the full send queue by removing the oldest droppable
+    // frame which has not been partially sent. Returns false if there is none.
+    bool dropOldest() {
+      for (size_t i = (_txOffset > 0) ? 1 : 0; i < _txCount; i++) {
+        if (!_txQueue[(_txHead + i) % TX_QUEUE_CAPACITY].droppable)
+          continue;
+        // Close the gap by moving the older frames up by one slot
+        for (size_t j = i; j > 0; j--)
+          _txQueue[(_txHead + j) % TX_QUEUE_CAPACITY] = std::move(_txQueue[(_txHead + j - 1) % TX_QUEUE_CAPACITY]);
+        _txQueue[_txHead].shared.reset();
+        _txHead = (_txHead + 1) % TX_QUEUE_CAPACITY;
+        _txCount--;
+        _txDropped.fetch_add(1, std::memory_order_relaxed);
+        return true;
+      }
+      return false;
+    }
+
     int _fileDescriptor = -1;
     TransportSocket& _server;
+    ByteRing _rxBuffer{ RX_BUFFER_SIZE };
+
+    // Send queue, a ring of fixed size frames
+    std::mutex _txMutex;
+    std::unique_ptr<TxFrame[]> _txQueue{ new TxFrame[TX_QUEUE_CAPACITY] };
+    size_t _txHead = 0;
+    size_t _txCount = 0;
+    size_t _txOffset = 0;        // bytes of the head frame already sent
+    bool _txScheduled = false;   // a flush has been requested
+    std::atomic<uint64_t> _txDropped{ 0 };
   };
 
 public:
   TransportSocket(int port) : _port(port) {
+    std::string labels = "port=\"" + std::to_string(port) + "\"";
+    MetricsRegistry& metrics = MetricsRegistry::instance();
+    _accepts = metrics.counter( "transport_accepts_total", "Accepted client connections.", labels );
+    _rejects = metrics.counter( "transport_rejects_total", "Client connections closed for lack of file descriptors.", labels );
+    _reads = metrics.counter( "transport_reads_total", "Read events handled on client connections.", labels );
+    _bytesReceived = metrics.counter( "transport_received_bytes_total", "Bytes received from client connections.", labels );
   }
 
 
@@ -161,26 +425,87 @@ public:
   }
 
 
+  // Number of I/O worker threads running the accept and read handlers. All
+  // events of one connection go to the same worker, so its frames are
+  // handled in order. With 0 (default) the handlers run inline on the
+  // listening thread. Must be set before listening starts.
+  void setIoWorkers( size_t numWorkers ) {
+    _numIoWorkers = numWorkers;
+  }
+
+
+  // Closes client connections which have been silent for the given time;
+  // 0 disables the timeout. Must be set before listening starts.
+  void setIdleTimeout( int64_t timeoutMs ) {
+    _idleTimeoutMs = timeoutMs;
+  }
+
+
+  // Only accepts connections from the local host, e.g. for a diagnostics
+  // port. Must be set before listening starts.
+  void setLocalOnly( bool localOnly ) {
+    _localOnly = localOnly;
+  }
+
+
   void close() {
 #ifndef __WIN32__
-    if( _socket )
+    if( _socket != -1 )
       ::close( _socket );
+    _socket = -1;
 #else
     closesocket(_socket);
     WSACleanup();
 #endif
 
-    for( auto&& clientSocket : _clientSockets )
-      clientSocket->close();
+    closeClients();
+
+#ifndef __WIN32__
+    if( _wakeFd != -1 )
+      ::close( _wakeFd );
+    _wakeFd = -1;
+
+    if( _spareFd != -1 )
+      ::close( _spareFd );
+    _spareFd = -1;
 
-    _clientSockets.clear();
+    if( _epoll != -1 )
+      ::close( _epoll );
+    _epoll = -1;
+#endif
+  }
+
+
+  // Closes all client connections; their close handlers are called first
+  void closeClients() {
+    std::vector<std::shared_ptr<ClientSocket>> closedSockets;
+    {
+      std::lock_guard<std::mutex> lock(_staleFileDescriptorsMutex);
+      for( auto&& clientSocket : _clientSockets )
+        closedSockets.push_back( clientSocket.second );
+      _clientSockets.clear();
+    }
+
+    for( auto&& clientSocket : closedSockets )
+      notifyClose( clientSocket );
+
+    std::lock_guard<std::mutex> lock(_staleFileDescriptorsMutex);
+
+    for( auto&& clientSocket : closedSockets )
+      _staleFileDescriptors.push_back( clientSocket->fileDescriptor() );
+
+#ifndef __WIN32__
+    for( auto&& fileDescriptor : _staleFileDescriptors )
+      ::close( fileDescriptor );
+    _staleFileDescriptors.clear();
+#endif
   }
 
 
 
 #ifdef __WIN32__
-  void listen(std::function<bool ()> stopRequested) {
-    std::cout << "Transport Socket Listening starts..." << std::endl;
+  void listen(std::function<bool ()> stopRequested) override {
+    LOG_INFO("Transport Socket Listening starts...");
     WSADATA wsaData;
     int iResult;
 
@@ -202,7 +527,7 @@ public:
     hints.ai_flags = AI_PASSIVE;
 
     // Resolve the server address and port
-    iResult = getaddrinfo(NULL, DEFAULT_PORT, &hints, &result);
+    iResult = getaddrinfo(_localOnly ? "127.0.0.1" : NULL, std::to_string(_port).c_str(), &hints, &result);
     if ( iResult != 0 ) {
       WSACleanup();
       throw std::runtime_error("getaddrinfo failed with error: " + std::to_string(iResult));
@@ -234,6 +559,8 @@ public:
       throw std::runtime_error("Listen failed with error: " + std::to_string(WSAGetLastError()));
     }
 
+    startIoWorkers();
+
     fd_set masterSocketSet;
     fd_set clientSocketSet;
 
@@ -246,10 +573,9 @@ public:
 
     while(stopRequested() == false) {
       clientSocketSet = masterSocketSet;
-      tv.tv_sec = 1;
-      tv.tv_usec = 0;
+      selectTimeout(tv);
 
-//      std::cout << "select" << std::endl;
+//      LOG_DEBUG("select");
 
       int numFileDescriptors = select( highestFileDescriptor + 1,
                                        &clientSocketSet,
@@ -261,6 +587,9 @@ public:
       if( numFileDescriptors == -1 )
         break;
 
+      // Expire the idle connections
+      _timers.advance(current_time_ms());
+
       // Will be updated in the loop as soon as a new client has been
       // accepted. This saves us from modifying the variable *during*
       // the loop execution.
@@ -278,23 +607,34 @@ public:
           int clientFileDescriptor = accept( _socket,
                                              reinterpret_cast<sockaddr*>( &clientAddress ),
                                              reinterpret_cast<socklen_t*>( &clientAddressLength ) );
-          std::cout << "accept Desc:" << clientFileDescriptor << std::endl;
+          LOG_INFO("accept Desc:{}", clientFileDescriptor);
 
           if( clientFileDescriptor == -1 )
             break;
+          _accepts->add();
+
+          // Clients are non-blocking: reads drain the socket and queued
+          // frames are sent without ever stalling the loop.
+          // If iMode != 0, non-blocking mode is enabled.
+          u_long iMode = 1;
+          ioctlsocket(clientFileDescriptor, FIONBIO, &iMode);
 
           FD_SET( clientFileDescriptor, &masterSocketSet );
           newHighestFileDescriptor = std::max( highestFileDescriptor, clientFileDescriptor );
 
           auto clientSocket = std::make_shared<ClientSocket>( clientFileDescriptor, *this );
+          armIdleTimer( clientFileDescriptor );
 
           if( _handleAccept ) {
-            auto result = std::async( std::launch::async, _handleAccept, clientSocket );
+            dispatch( clientFileDescriptor, _handleAccept, clientSocket );
           } else {
-            std::cout << "_handleAccept NULL" << std::endl;
+            LOG_WARN("_handleAccept NULL");
           }
 
-          _clientSockets.push_back( clientSocket );
+          {
+            std::lock_guard<std::mutex> lock( _staleFileDescriptorsMutex );
+            _clientSockets[clientFileDescriptor] = clientSocket;
+          }
         }
 
         // Known client socket
@@ -310,17 +650,15 @@ public:
             // It would be easier to use erase-remove here, but this leads
             // to a deadlock. Instead, the current socket will be added to
             // the list of stale sockets and be closed later on.
-            this->close( i );
+            dispatchClose( i );
           }
           else {
-            auto itSocket = std::find_if( _clientSockets.begin(), _clientSockets.end(),
-                                          [&] ( std::shared_ptr<ClientSocket> socket )
-                                          {
-                                            return socket->fileDescriptor() == i;
-                                          } );
+            auto clientSocket = findClient( i );
 
-            if( itSocket != _clientSockets.end() && _handleRead )
-              auto result = std::async( std::launch::async, _handleRead, *itSocket );
+            armIdleTimer( i );
+            _reads->add();
+            if( clientSocket && _handleRead )
+              dispatch( i, _handleRead, clientSocket );
           }
         }
       }
@@ -329,6 +667,9 @@ public:
       // the loop above.
       highestFileDescriptor = std::max( newHighestFileDescriptor, highestFileDescriptor );
 
+      // Send what is left in the queues of the slow connections
+      flushClients();
+
       // Handle stale connections. This is in an extra scope so that the
       // lock guard unlocks the mutex automatically.
       {
@@ -336,202 +677,535 @@ public:
 
         for(auto&& fileDescriptor : _staleFileDescriptors) {
           FD_CLR( fileDescriptor, &masterSocketSet );
+          _idleTimers.erase( fileDescriptor );
           ::close( fileDescriptor );
         }
 
         _staleFileDescriptors.clear();
       }
     }
-    std::cout << "Transport Socket Listening exits." << std::endl;
+    stopIoWorkers();
+    LOG_INFO("Transport Socket Listening exits.");
   }
 
 #else
 
-  void listen() {
-	  _socket = socket( AF_INET, SOCK_STREAM, 0 );
+  void listen(std::function<bool ()> stopRequested) override {
+    LOG_INFO("Transport Socket Listening starts...");
+
+    // The listening socket is non-blocking, so that all pending connections
+    // are accepted in one go on an edge-triggered event
+    _socket = socket( AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0 );
+
+    if( _socket == -1 )
+      throw std::runtime_error( std::string( strerror( errno ) ) );
+
+    {
+      int option = 1;
+
+      setsockopt( _socket,
+                  SOL_SOCKET,
+                  SO_REUSEADDR,
+                  reinterpret_cast<const void*>( &option ),
+                  sizeof( option ) );
+    }
+
+    sockaddr_in socketAddress;
 
-	  if( _socket == -1 )
-	    throw std::runtime_error( std::string( strerror( errno ) ) );
+    std::fill( reinterpret_cast<char*>( &socketAddress ),
+               reinterpret_cast<char*>( &socketAddress ) + sizeof( socketAddress ),
+               0 );
 
-	  {
-	    int option = 1;
+    socketAddress.sin_family      = AF_INET;
+    socketAddress.sin_addr.s_addr = htonl( _localOnly ? INADDR_LOOPBACK : INADDR_ANY );
+    socketAddress.sin_port        = htons( _port );
 
-	    setsockopt( _socket,
-	                SOL_SOCKET,
-	                SO_REUSEADDR,
-	                reinterpret_cast<const void*>( &option ),
-	                sizeof( option ) );
-	  }
+    {
+      int result = bind( _socket,
+                         reinterpret_cast<const sockaddr*>( &socketAddress ),
+                         sizeof( socketAddress ) );
 
-	  sockaddr_in socketAddress;
+      if( result == -1 )
+        throw std::runtime_error( std::string( strerror( errno ) ) );
+    }
+
+    {
+      int result = ::listen( _socket, _backlog );
+
+      if( result == -1 )
+        throw std::runtime_error( std::string( strerror( errno ) ) );
+    }
+
+    _epoll = epoll_create1( EPOLL_CLOEXEC );
+
+    if( _epoll == -1 )
+      throw std::runtime_error( std::string( strerror( errno ) ) );
+
+    watch( _socket, EPOLLIN | EPOLLET );
+
+    // Wakes the loop up when frames have been queued for sending or a stop
+    // has been requested. It outlives the listening loop, so that a late
+    // wake-up never hits a reused file descriptor.
+    if( _wakeFd == -1 )
+      _wakeFd = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
 
-	  std::fill( reinterpret_cast<char*>( &socketAddress ),
-	             reinterpret_cast<char*>( &socketAddress ) + sizeof( socketAddress ),
-	             0 );
+    if( _wakeFd == -1 )
+      throw std::runtime_error( std::string( strerror( errno ) ) );
 
-	  socketAddress.sin_family      = AF_INET;
-	  socketAddress.sin_addr.s_addr = htonl( INADDR_ANY );
-	  socketAddress.sin_port        = htons( _port );
-
-	  {
-	    int result = bind( _socket,
-	                       reinterpret_cast<const sockaddr*>( &socketAddress ),
-	                       sizeof( socketAddress ) );
-
-	    if( result == -1 )
-	      throw std::runtime_error( std::string( strerror( errno ) ) );
-	  }
-
-	  {
-	    int result = ::listen( _socket, _backlog );
-
-	    if( result == -1 )
-	      throw std::runtime_error( std::string( strerror( errno ) ) );
-	  }
-
-	  fd_set masterSocketSet;
-	  fd_set clientSocketSet;
-
-	  FD_ZERO( &masterSocketSet );
-	  FD_SET( _socket, &masterSocketSet );
-
-	  int highestFileDescriptor = _socket;
-
-	  while( 1 )
-	  {
-	    clientSocketSet = masterSocketSet;
-
-	    int numFileDescriptors = select( highestFileDescriptor + 1,
-	                                     &clientSocketSet,
-	                                     nullptr,   // no descriptors to write into
-	                                     nullptr,   // no descriptors with exceptions
-	                                     nullptr ); // no timeout
-
-	    if( numFileDescriptors == -1 )
-	      break;
-
-	    // Will be updated in the loop as soon as a new client has been
-	    // accepted. This saves us from modifying the variable *during*
-	    // the loop execution.
-	    int newHighestFileDescriptor = highestFileDescriptor;
-
-	    for( int i = 0; i <= highestFileDescriptor; i++ )
-	    {
-	      if( !FD_ISSET( i, &clientSocketSet ) )
-	        continue;
-
-	      // Handle new client
-	      if( i == _socket )
-	      {
-	        sockaddr_in clientAddress;
-	        auto clientAddressLength = sizeof(clientAddress);
-
-	        int clientFileDescriptor = accept( _socket,
-	                                           reinterpret_cast<sockaddr*>( &clientAddress ),
-	                                           reinterpret_cast<socklen_t*>( &clientAddressLength ) );
-
-	        if( clientFileDescriptor == -1 )
-	          break;
-
-	        FD_SET( clientFileDescriptor, &masterSocketSet );
-	        newHighestFileDescriptor = std::max( highestFileDescriptor, clientFileDescriptor );
-
-	        auto clientSocket = std::make_shared<ClientSocket>( clientFileDescriptor, *this );
-
-	        if( _handleAccept )
-	          auto result = std::async( std::launch::async, _handleAccept, clientSocket );
-
-	        _clientSockets.push_back( clientSocket );
-	      }
-
-	      // Known client socket
-	      else
-	      {
-	        char buffer[2] = {0,0};
-
-	        // Let's attempt to read at least one byte from the connection, but
-	        // without removing it from the queue. That way, the server can see
-	        // whether a client has closed the connection.
-	        int result = recv( i, buffer, 1, MSG_PEEK );
-
-	        if( result <= 0 )
-	        {
-	          // It would be easier to use erase-remove here, but this leads
-	          // to a deadlock. Instead, the current socket will be added to
-	          // the list of stale sockets and be closed later on.
-	          this->close( i );
-	        }
-	        else
-	        {
-	          auto itSocket = std::find_if( _clientSockets.begin(), _clientSockets.end(),
-	                                        [&] ( std::shared_ptr<ClientSocket> socket )
-	                                        {
-	                                          return socket->fileDescriptor() == i;
-	                                        } );
-
-	          if( itSocket != _clientSockets.end() && _handleRead )
-	            auto result = std::async( std::launch::async, _handleRead, *itSocket );
-	        }
-	      }
-	    }
-
-	    // Update the file descriptor if a new client has been accepted in
-	    // the loop above.
-	    highestFileDescriptor = std::max( newHighestFileDescriptor, highestFileDescriptor );
-
-	    // Handle stale connections. This is in an extra scope so that the
-	    // lock guard unlocks the mutex automatically.
-	    {
-	      std::lock_guard<std::mutex> lock( _staleFileDescriptorsMutex );
-
-	      for( auto&& fileDescriptor : _staleFileDescriptors )
-	      {
-	        FD_CLR( fileDescriptor, &masterSocketSet );
-	        ::close( fileDescriptor );
-	      }
-
-	      _staleFileDescriptors.clear();
-	    }
-	  }
+    watch( _wakeFd, EPOLLIN );
+
+    // Spare descriptor which is given up to shed a pending connection when
+    // the process runs out of descriptors
+    if( _spareFd == -1 )
+      _spareFd = ::open( "/dev/null", O_RDONLY | O_CLOEXEC );
+
+    startIoWorkers();
+
+    // Unlike select(), the cost of one wake-up only depends on the number of
+    // ready sockets and not on the number of connections or on the highest
+    // file descriptor
+    epoll_event events[MAX_EVENTS];
+
+    while( stopRequested() == false )
+    {
+      int numEvents = epoll_wait( _epoll,
+                                  events,
+                                  MAX_EVENTS,
+                                  nextTimeoutMs() );
+
+      if( numEvents == -1 )
+      {
+        if( errno == EINTR )
+          continue;
+        break;
+      }
+
+      // Expire the idle connections
+      _timers.advance( current_time_ms() );
+
+      for( int n = 0; n < numEvents; n++ )
+      {
+        int fileDescriptor = events[n].data.fd;
+
+        // Handle new clients
+        if( fileDescriptor == _socket )
+        {
+          acceptClients();
+          continue;
+        }
+
+        // Send the newly queued frames
+        if( fileDescriptor == _wakeFd )
+        {
+          flushScheduled();
+          continue;
+        }
+
+        // Known client socket. The read handler drains the socket up to
+        // EAGAIN, as required by the edge-triggered mode; a hang-up is only
+        // handled after the data which came before it has been read.
+        auto clientSocket = findClient( fileDescriptor );
+        if( !clientSocket )
+          continue;
+
+        if( events[n].events & EPOLLIN )
+        {
+          armIdleTimer( fileDescriptor );
+          _reads->add();
+          if( _handleRead )
+            dispatch( fileDescriptor, _handleRead, clientSocket );
+        }
+
+        // The socket has room again for the frames left in its queue
+        if( ( events[n].events & EPOLLOUT ) && !clientSocket->flush() )
+          dispatchClose( fileDescriptor );
+
+        if( events[n].events & ( EPOLLRDHUP | EPOLLHUP | EPOLLERR ) )
+          dispatchClose( fileDescriptor );
+      }
+
+      // Handle stale connections. This is in an extra scope so that the
+      // lock guard unlocks the mutex automatically.
+      {
+        std::lock_guard<std::mutex> lock( _staleFileDescriptorsMutex );
+
+        for( auto&& fileDescriptor : _staleFileDescriptors )
+        {
+          epoll_ctl( _epoll, EPOLL_CTL_DEL, fileDescriptor, nullptr );
+          _idleTimers.erase( fileDescriptor );
+          ::close( fileDescriptor );
+        }
+
+        _staleFileDescriptors.clear();
+      }
+    }
+    stopIoWorkers();
+
+    // Release the port and the connections, so that listening may start
+    // again right away
+    closeClients();
+    _idleTimers.clear();
+    _timers.cancel( _acceptRetry );
+    ::close( _socket );
+    _socket = -1;
+    ::close( _epoll );
+    _epoll = -1;
+    LOG_INFO("Transport Socket Listening exits.");
   }
 #endif
 
 
-  template <class F> void onAccept( F&& f ) {
-    _handleAccept = f;
+  void onAccept( Handler handler ) override {
+    _handleAccept = std::move( handler );
   }
 
 
-  template <class F> void onRead( F&& f ) {
-    _handleRead = f;
+  void onRead( Handler handler ) override {
+    _handleRead = std::move( handler );
+  }
+
+
+  // The close handler is called once for every connection, by the thread
+  // which closes it, after the connection has been removed from the set of
+  // open connections
+  void onClose( Handler handler ) override {
+    _handleClose = std::move( handler );
   }
 
 
   void close( int fileDescriptor ) {
-    std::lock_guard<std::mutex> lock(_staleFileDescriptorsMutex);
+    std::shared_ptr<ClientSocket> clientSocket;
+    {
+      std::lock_guard<std::mutex> lock(_staleFileDescriptorsMutex);
+
+      // A socket is only closed once, even if it is closed by several parties
+      auto itSocket = _clientSockets.find(fileDescriptor);
+      if (itSocket == _clientSockets.end())
+        return;
+      clientSocket = itSocket->second;
+      _clientSockets.erase(itSocket);
+    }
+
+    // The handler runs before the file descriptor is queued for closing, so
+    // it is done before the descriptor can be reused by a new connection
+    notifyClose(clientSocket);
+
+    {
+      std::lock_guard<std::mutex> lock(_staleFileDescriptorsMutex);
+      _staleFileDescriptors.push_back(fileDescriptor);
+    }
+
+    // The descriptor is closed by the listening thread, which may be waiting
+    // without a timeout when an I/O worker closes the connection
+    interrupt();
+  }
+
+
+#ifndef __WIN32__
+  // Wakes the listening thread up, so that it notices a stop request at once
+  void interrupt() override {
+    if( _wakeFd != -1 )
+    {
+      uint64_t one = 1;
+      ssize_t result = ::write( _wakeFd, &one, sizeof( one ) );
+      (void)result;   // EAGAIN: the counter is pending anyway
+    }
+  }
+
 
-    _clientSockets.erase(std::remove_if(_clientSockets.begin(), _clientSockets.end(),
-                                         [&] (std::shared_ptr<ClientSocket> socket)
-                                         {
-                                           return socket->fileDescriptor() == fileDescriptor;
-                                         }),
-                                         _clientSockets.end());
+  // Asks the listening thread to send the queued frames of a connection
+  void scheduleFlush( int fileDescriptor ) {
+    bool wake;
+    {
+      std::lock_guard<std::mutex> lock( _flushMutex );
+      wake = _flushFileDescriptors.empty();
+      _flushFileDescriptors.push_back( fileDescriptor );
+    }
 
-    _staleFileDescriptors.push_back(fileDescriptor);
+    if( wake )
+      interrupt();
   }
+#endif
 
 private:
+  // Looks up the client socket of a file descriptor
+  std::shared_ptr<ClientSocket> findClient( int fileDescriptor ) {
+    std::lock_guard<std::mutex> lock( _staleFileDescriptorsMutex );
+
+    auto itSocket = _clientSockets.find( fileDescriptor );
+    return ( itSocket != _clientSockets.end() ) ? itSocket->second : nullptr;
+  }
+
+
+  void notifyClose( std::shared_ptr<ClientSocket> clientSocket ) {
+    if( !_handleClose )
+      return;
+
+    try {
+      _handleClose( clientSocket );
+    } catch( const std::exception& e ) {
+      LOG_ERROR("Transport Socket handler failed: {}", e.what());
+    }
+  }
+
+
+  void startIoWorkers() {
+    for( size_t i = 0; i < _numIoWorkers; i++ )
+      _ioWorkers.emplace_back( new IoWorker() );
+  }
+
+
+  // Runs the pending handlers and joins the workers
+  void stopIoWorkers() {
+    _ioWorkers.clear();
+  }
+
+
+  // Runs a handler for the connection, either inline or on the worker the
+  // connection is pinned to. A failing handler only drops the event.
+  void dispatch( int fileDescriptor, const Handler& handler, std::shared_ptr<ClientSocket> clientSocket ) {
+    const Handler* h = &handler;
+    auto task = [h, clientSocket] ()
+    {
+      try {
+        ( *h )( clientSocket );
+      } catch( const std::exception& e ) {
+        LOG_ERROR("Transport Socket handler failed: {}", e.what());
+      }
+    };
+
+    if( _ioWorkers.empty() )
+      task();
+    else
+      _ioWorkers[static_cast<size_t>( fileDescriptor ) % _ioWorkers.size()]->post( task );
+  }
+
+
+  // Closes the connection after the handlers already dispatched for it
+  void dispatchClose( int fileDescriptor ) {
+    if( _ioWorkers.empty() )
+      this->close( fileDescriptor );
+    else
+      _ioWorkers[static_cast<size_t>( fileDescriptor ) % _ioWorkers.size()]->post( [this, fileDescriptor] ()
+                                                                                    {
+                                                                                      this->close( fileDescriptor );
+                                                                                    } );
+  }
+
+
+#ifndef __WIN32__
+  static const int MAX_EVENTS = 64;
+
+  // Registers a file descriptor with the epoll instance
+  void watch( int fileDescriptor, uint32_t events ) {
+    epoll_event event;
+    event.events  = events;
+    event.data.fd = fileDescriptor;
+
+    if( epoll_ctl( _epoll, EPOLL_CTL_ADD, fileDescriptor, &event ) == -1 )
+      throw std::runtime_error( std::string( strerror( errno ) ) );
+  }
+
+
+  // Accepts all pending connections of the listening socket
+  void acceptClients() {
+    while( 1 )
+    {
+      sockaddr_in clientAddress;
+      socklen_t clientAddressLength = sizeof(clientAddress);
+
+      int clientFileDescriptor = accept4( _socket,
+                                          reinterpret_cast<sockaddr*>( &clientAddress ),
+                                          &clientAddressLength,
+                                          SOCK_NONBLOCK | SOCK_CLOEXEC );
+
+      if( clientFileDescriptor == -1 )
+      {
+        if( errno == EINTR || errno == ECONNABORTED )
+          continue;
+        if( errno == EAGAIN || errno == EWOULDBLOCK )
+          break;  // no more pending connections
+
+        // The listening socket is edge-triggered, so the connections left
+        // in the backlog raise no new event. Without descriptors they are
+        // shed one by one; otherwise (out of memory) the backlog is drained
+        // again from the timer wheel.
+        int error = errno;
+        LOG_WARN("accept failed: {}", strerror( error ));
+        if( ( error == EMFILE || error == ENFILE ) && _spareFd != -1 )
+        {
+          if( rejectClient() )
+            continue;
+          break;
+        }
+        _timers.schedule( _acceptRetry, current_time_ms() + ACCEPT_RETRY_MS );
+        break;
+      }
+      LOG_INFO("accept Desc:{}", clientFileDescriptor);
+      _accepts->add();
+
+      auto clientSocket = std::make_shared<ClientSocket>( clientFileDescriptor, *this );
+      {
+        std::lock_guard<std::mutex> lock( _staleFileDescriptorsMutex );
+        _clientSockets[clientFileDescriptor] = clientSocket;
+      }
+
+      watch( clientFileDescriptor, EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET );
+      armIdleTimer( clientFileDescriptor );
+
+      if( _handleAccept )
+        dispatch( clientFileDescriptor, _handleAccept, clientSocket );
+    }
+  }
+
+
+  // Accepts and closes the next pending connection on the spare descriptor.
+  // Returns false if no connection has been shed; when this is not because
+  // the backlog is empty, it is drained again from the timer wheel.
+  bool rejectClient() {
+    ::close( _spareFd );
+    int clientFileDescriptor = accept4( _socket, nullptr, nullptr, SOCK_CLOEXEC );
+    int error = errno;
+    if( clientFileDescriptor != -1 )
+      ::close( clientFileDescriptor );
+    _spareFd = ::open( "/dev/null", O_RDONLY | O_CLOEXEC );
+
+    if( clientFileDescriptor == -1 )
+    {
+      if( error != EAGAIN && error != EWOULDBLOCK )
+        _timers.schedule( _acceptRetry, current_time_ms() + ACCEPT_RETRY_MS );
+      return false;
+    }
+    LOG_WARN("Rejected a connection: out of file descriptors");
+    _rejects->add();
+    return true;
+  }
+
+
+  // Flushes the connections whose send queues have been filled since the
+  // last wake-up. The frames of many writes go out in one gather write.
+  void flushScheduled() {
+    uint64_t count;
+    ssize_t result = ::read( _wakeFd, &count, sizeof( count ) );
+    (void)result;
+
+    std::vector<int> fileDescriptors;
+    {
+      std::lock_guard<std::mutex> lock( _flushMutex );
+      fileDescriptors.swap( _flushFileDescriptors );
+    }
+
+    for( int fileDescriptor : fileDescriptors )
+    {
+      auto clientSocket = findClient( fileDescriptor );
+      if( clientSocket && !clientSocket->flush() )
+        dispatchClose( fileDescriptor );
+    }
+  }
+#else
+
+  // Sends the queued frames of all connections; the sockets which would
+  // block are retried on the next pass of the select loop
+  void flushClients() {
+    std::vector<std::shared_ptr<ClientSocket>> clientSockets;
+    {
+      std::lock_guard<std::mutex> lock( _staleFileDescriptorsMutex );
+      for( auto&& clientSocket : _clientSockets )
+        clientSockets.push_back( clientSocket.second );
+    }
+
+    for( auto&& clientSocket : clientSockets )
+      if( clientSocket->txQueued() > 0 && !clientSocket->flush() )
+        dispatchClose( clientSocket->fileDescriptor() );
+  }
+#endif
+
+
+  // (Re-)arms the idle timer of a client connection. Only called from the
+  // listening thread, which owns the timer wheel.
+  void armIdleTimer( int fileDescriptor ) {
+    if( _idleTimeoutMs <= 0 )
+      return;
+
+    auto& timer = _idleTimers[fileDescriptor];
+    if( !timer )
+      timer.reset( new TimerWheel::Timer( [this, fileDescriptor] ()
+                                          {
+                                            LOG_INFO("Idle timeout Desc:{}", fileDescriptor);
+                                            dispatchClose( fileDescriptor );
+                                          } ) );
+    _timers.schedule( *timer, current_time_ms() + _idleTimeoutMs );
+  }
+
+
+#ifndef __WIN32__
+  // Timeout of the event wait: the next timer expiry, or infinite (-1)
+  // without any pending timer. A stop request interrupts the wait through
+  // the wake-up eventfd.
+  int nextTimeoutMs() {
+    int64_t expiry = _timers.next_expiry_ms();
+    if( expiry == TimerWheel::NEVER )
+      return -1;
+    int64_t timeoutMs = std::min( expiry - current_time_ms(), int64_t( std::numeric_limits<int>::max() ) );
+    return ( timeoutMs < 0 ) ? 0 : static_cast<int>( timeoutMs );
+  }
+#else
+  // Timeout of the event wait: one second at most, so that a stop request
+  // is noticed, and no later than the next timer expiry
+  int64_t nextTimeoutMs() {
+    int64_t timeoutMs = std::min( _timers.next_expiry_ms() - current_time_ms(), int64_t(1000) );
+    return ( timeoutMs < 0 ) ? 0 : timeoutMs;
+  }
+
+
+  void selectTimeout( struct timeval& tv ) {
+    int64_t timeoutMs = nextTimeoutMs();
+    tv.tv_sec  = static_cast<long>( timeoutMs / 1000 );
+    tv.tv_usec = static_cast<long>( ( timeoutMs % 1000 ) * 1000 );
+  }
+#endif
+
   int _backlog =  1;
   int _port    = -1;
   int _socket  = -1;
+  int _epoll   = -1;
+  int _wakeFd  = -1;
+  int _spareFd = -1;
+  int64_t _idleTimeoutMs = 0;
+  bool _localOnly = false;
+
+  // Counters of the reactor, labeled with the port
+  std::shared_ptr<Counter> _accepts;
+  std::shared_ptr<Counter> _rejects;
+  std::shared_ptr<Counter> _reads;
+  std::shared_ptr<Counter> _bytesReceived;
+
+  // Timers of the listening thread: per-connection idle timeouts
+  TimerWheel _timers{ current_time_ms() };
+  std::unordered_map<int, std::unique_ptr<TimerWheel::Timer>> _idleTimers;
+
+#ifndef __WIN32__
+  // Drains the backlog again after accept has failed for lack of memory
+  static const int64_t ACCEPT_RETRY_MS = 100;
+  TimerWheel::Timer _acceptRetry{ [this] () { acceptClients(); } };
+#endif
 
-  std::function<void(std::weak_ptr<ClientSocket> socket)> _handleAccept;
-  std::function<void(std::weak_ptr<ClientSocket> socket)> _handleRead;
+  Handler _handleAccept;
+  Handler _handleRead;
+  Handler _handleClose;
 
-  std::vector<std::shared_ptr<ClientSocket>> _clientSockets;
+  size_t _numIoWorkers = 0;
+  std::vector<std::unique_ptr<IoWorker>> _ioWorkers;
+
+  // Open client connections indexed by their file descriptor
+  std::unordered_map<int, std::shared_ptr<ClientSocket>> _clientSockets;
 
   std::vector<int> _staleFileDescriptors;
   std::mutex _staleFileDescriptorsMutex;
+
+  // Connections with frames queued since the last wake-up
+  std::vector<int> _flushFileDescriptors;
+  std::mutex _flushMutex;
 };
 
 }
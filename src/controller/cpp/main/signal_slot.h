@@ -10,9 +10,80 @@
 #ifndef SIGNAL_SLOT_H
 #define SIGNAL_SLOT_H
 
+#include "MpscRing.h"
+
+#include <atomic>
 #include <functional>
-#include <map>
 #include <memory>
+#include <mutex>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+
+// Mailbox of a receiver thread for queued connections. The emitting thread
+// posts the call together with a copy of its arguments into a preallocated
+// ring, and the receiver thread runs the queued calls by dispatch(). A
+// queued call shares the ownership of its slot, so it may be dispatched
+// after the signal has been destroyed. The optional notify function is
+// called after every post, e.g. to wake up the receiver thread.
+template <typename... Args>
+class signal_mailbox {
+
+ public:
+
+  using slot_type = std::function<void(Args...)>;
+
+  // the capacity must be a power of two
+  explicit signal_mailbox(size_t capacity = 1024, std::function<void()> notify = nullptr) :
+      ring_(capacity), notify_(std::move(notify)), dropped_(0) {}
+
+  signal_mailbox(signal_mailbox const&) = delete;
+  signal_mailbox& operator=(signal_mailbox const&) = delete;
+
+  // emitting side: queues a call of the slot. Returns false if the mailbox
+  // is full and the call has been dropped.
+  bool post(const std::shared_ptr<const slot_type>& slot, Args... p) {
+    if (!ring_.try_push(Call{slot, std::tuple<typename std::decay<Args>::type...>(p...)})) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    if (notify_) notify_();
+    return true;
+  }
+
+  // receiving side: runs the queued calls in the order they were posted and
+  // returns their number
+  size_t dispatch() {
+    return ring_.consume_all([](Call&& call) {
+      invoke(call, std::index_sequence_for<Args...>());
+    });
+  }
+
+  // receiving side: true if no call is waiting
+  bool empty() const { return ring_.empty(); }
+
+  // number of calls dropped on a full mailbox
+  uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+ private:
+
+  struct Call {
+    std::shared_ptr<const slot_type> slot;
+    std::tuple<typename std::decay<Args>::type...> args;
+  };
+
+  template <size_t... I>
+  static void invoke(Call& call, std::index_sequence<I...>) {
+    (*call.slot)(std::get<I>(call.args)...);
+  }
+
+  MpscRing<Call> ring_;
+  std::function<void()> notify_;
+  std::atomic<uint64_t> dropped_;
+};
 
 
 
@@ -21,16 +92,25 @@
 // which will be called when the emit() method on the
 // signal object is invoked. Any argument passed to emit()
 // will be passed to the given functions.
+//
+// The slots are kept in a flat array which is never modified once it has
+// been published: connect() and disconnect() build a new array and swap it
+// in, so emit() walks the current array without any lock, copy or heap
+// allocation. Replaced arrays are kept until the signal is destroyed, since
+// an emit() on another thread may still be walking them; connections are
+// expected to change rarely, at set up time.
 
 template <typename... Args>
 class signal_slot {
 
  public:
 
-  signal_slot() : current_id_(0) {}
+  using slot_type = std::function<void(Args...)>;
+
+  signal_slot() : slots_(nullptr), current_id_(0) {}
 
   // copy creates new signal
-  signal_slot(signal_slot const& other) : current_id_(0) {}
+  signal_slot(signal_slot const& other) : slots_(nullptr), current_id_(0) {}
 
   // connects a member function to this Signal
   template <typename T>
@@ -71,35 +151,76 @@ class signal_slot {
 
   // connects a std::function to the signal. The returned
   // value can be used to disconnect the function again
-  int connect(std::function<void(Args...)> const& slot) const {
-    slots_.insert(std::make_pair(++current_id_, slot));
-    return current_id_;
+  int connect(slot_type const& slot) const {
+    return add(slot, nullptr);
+  }
+
+  // connects a std::function to the signal, which is called on the thread
+  // dispatching the given mailbox instead of the emitting thread
+  int connect_queued(std::shared_ptr<signal_mailbox<Args...>> mailbox, slot_type const& slot) const {
+    return add(slot, std::move(mailbox));
   }
 
   // disconnects a previously connected function
   void disconnect(int id) const {
-    slots_.erase(id);
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::unique_ptr<SlotList> slots(new SlotList());
+    if (const SlotList* current = slots_.load(std::memory_order_relaxed))
+      for (const auto& slot : *current)
+        if (slot.id != id) slots->push_back(slot);
+    publish(std::move(slots));
   }
 
   // disconnects all previously connected functions
   void disconnect_all() const {
-    slots_.clear();
+    std::lock_guard<std::mutex> lock(mutex_);
+    publish(std::unique_ptr<SlotList>(new SlotList()));
   }
 
   // calls all connected functions
   void emit(Args... p) {
-    for(auto it : slots_) {
-      it.second(p...);
+    const SlotList* slots = slots_.load(std::memory_order_acquire);
+    if (slots == nullptr) return;
+    for (const auto& slot : *slots) {
+      if (slot.mailbox) slot.mailbox->post(slot.func, p...);
+      else (*slot.func)(p...);
     }
   }
 
   // assignment creates new Signal
   signal_slot& operator=(signal_slot const& other) {
     disconnect_all();
+    return *this;
   }
 
  private:
-  mutable std::map<int, std::function<void(Args...)>> slots_;
+
+  struct Slot {
+    int id;
+    std::shared_ptr<const slot_type> func;
+    std::shared_ptr<signal_mailbox<Args...>> mailbox;
+  };
+  using SlotList = std::vector<Slot>;
+
+  int add(slot_type const& func, std::shared_ptr<signal_mailbox<Args...>> mailbox) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::unique_ptr<SlotList> slots(new SlotList());
+    if (const SlotList* current = slots_.load(std::memory_order_relaxed))
+      *slots = *current;
+    slots->push_back(Slot{++current_id_, std::make_shared<const slot_type>(func), std::move(mailbox)});
+    publish(std::move(slots));
+    return current_id_;
+  }
+
+  // swaps in a new slot array; must be called with the mutex locked
+  void publish(std::unique_ptr<SlotList> slots) const {
+    slots_.store(slots.get(), std::memory_order_release);
+    lists_.push_back(std::move(slots));
+  }
+
+  mutable std::mutex mutex_;
+  mutable std::atomic<const SlotList*> slots_;
+  mutable std::vector<std::unique_ptr<SlotList>> lists_;  // current and replaced arrays
   mutable int current_id_;
 };
 
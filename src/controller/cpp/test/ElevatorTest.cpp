@@ -8,10 +8,12 @@
 
 #include <gtest\gtest.h>
 #include <Elevator.h>
+#include <ElevatorSim.h>
 
 #include <chrono>
 #include <random>
 #include <list>
+#include <map>
 #include <queue>
 #include <iterator>
 #include <vector>
@@ -26,7 +28,8 @@ protected:
   std::unique_ptr<Elevator> elevator;
 
   ElevatorTest() {
-    elevator = std::unique_ptr<Elevator>(new Elevator(""));
+    // No event trace is written by the tests which do not ask for one
+    elevator = std::unique_ptr<Elevator>(new Elevator("", 1, ""));
   }
 
   virtual ~ElevatorTest() {
@@ -72,4 +75,171 @@ TEST_F(ElevatorTest, testSafeExiting) {
 }
 
 
+TEST(ElevatorGroupTest, testCallAssignment) {
+  ElevatorGroupCtrl group(4);
+  ASSERT_EQ(4u, group.size());
+
+  // All cars are idle at the lobby: the first car wins the tie
+  EXPECT_EQ(0u, group.assign(5, Request::Direction::UP));
+
+  // Once car 0 holds a pending stop, the next call goes to an idle car
+  group.input_data_consumer(CarCommand{1, 1, Request::Command::CALL, 5, Request::Direction::UP});
+  EXPECT_EQ(1u, group.assign(5, Request::Direction::UP));
+}
+
+
+TEST(ElevatorGroupTest, testStopLatency) {
+  CarDriver driver;
+  driver.add(std::make_shared<ElevatorCtrl>());
+
+  // The idle driver sleeps without a timeout; a stop request wakes it up at
+  // once, and the driver may be started again afterwards
+  for (int round = 0; round < 2; round++) {
+    driver.make_process_thread();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    auto start = std::chrono::steady_clock::now();
+    driver.stop_process_thread();
+    driver.join_process_thread();
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(200));
+  }
+}
+
+
+// Replays a short scenario on the virtual clock and returns the status log
+static std::vector<ElevatorSimulator::StatusRecord> simulateScenario() {
+  ElevatorSimulator sim(2);
+  sim.schedule(0, 1, 1, Request::Command::CALL, 5, Request::Direction::UP);
+  sim.schedule(500, 2, 2, Request::Command::CALL, 3, Request::Direction::UP);
+  sim.schedule(20000, 3, 3, Request::Command::CALL, 8, Request::Direction::DOWN);
+  sim.schedule(40000, 1, 4, Request::Command::GO, 2, Request::Direction::UP);
+  sim.run_until(3600 * 1000);
+  sim.stop();
+  return sim.log();
+}
+
+
+TEST(ElevatorSimTest, testVirtualTimeReplay) {
+  auto start = std::chrono::steady_clock::now();
+  auto log = simulateScenario();
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  // One hour of virtual time is replayed in well under a second of wall time
+  EXPECT_LT(elapsed, std::chrono::seconds(5));
+
+  // Car 0 reaches floor 5 after travelling five floors
+  auto reached = std::find_if(log.begin(), log.end(), [](const ElevatorSimulator::StatusRecord& r) {
+    return r.msg_id == 1 && r.state == ElevatorCtrl::State::STOPPED;
+  });
+  ASSERT_NE(log.end(), reached);
+  EXPECT_EQ(5, reached->floor);
+  EXPECT_EQ(5 * ElevatorCtrl::FLOOR_TRAVEL_MS, reached->time_ms);
+
+  // A second replay takes exactly the same decisions at the same times
+  auto replay = simulateScenario();
+  ASSERT_EQ(log.size(), replay.size());
+  for (size_t i = 0; i < log.size(); i++) {
+    EXPECT_EQ(log[i].time_ms, replay[i].time_ms);
+    EXPECT_EQ(log[i].msg_id, replay[i].msg_id);
+    EXPECT_EQ(log[i].floor, replay[i].floor);
+  }
+}
+
+
+TEST(ElevatorSimTest, testOnTheWayStop) {
+  // Both cars are stepped by a single driver thread
+  ElevatorSimulator sim(2, 0, 2);
+  ASSERT_EQ(1u, sim.group()->num_drivers());
+
+  sim.schedule(0, 1, 1, Request::Command::CALL, 10, Request::Direction::UP);
+  // Issued while car 0 is passing floor 2 on its way up
+  sim.schedule(2500, 2, 2, Request::Command::GO, 4, Request::Direction::UP);
+  sim.run_until(60 * 1000);
+  sim.stop();
+
+  std::vector<std::pair<uint16_t, int64_t>> stops;
+  for (const auto& r : sim.log())
+    if (r.state == ElevatorCtrl::State::STOPPED) stops.push_back(std::make_pair(r.msg_id, r.time_ms));
+
+  // The car call is served on the way, before the car reaches floor 10
+  ASSERT_EQ(2u, stops.size());
+  EXPECT_EQ(2, stops[0].first);
+  EXPECT_EQ(4 * ElevatorCtrl::FLOOR_TRAVEL_MS, stops[0].second);
+  EXPECT_EQ(1, stops[1].first);
+  EXPECT_EQ(10 * ElevatorCtrl::FLOOR_TRAVEL_MS + ElevatorCtrl::DOOR_DWELL_MS, stops[1].second);
+}
+
+
+TEST(ElevatorSimTest, testLatencyHistograms) {
+  ElevatorSimulator sim(1);
+
+  // The car reaches floor 5 after 5 s; the passenger's car call is issued
+  // after the doors have closed and takes the car down to floor 2
+  sim.schedule(0, 1, 1, Request::Command::CALL, 5, Request::Direction::UP);
+  sim.schedule(10000, 1, 2, Request::Command::GO, 2, Request::Direction::DOWN);
+  sim.run_until(60 * 1000);
+  sim.stop();
+
+  LatencyHistogram wait, waitDown, ride;
+  sim.group()->waitTimes(wait, 5, Request::Direction::UP);
+  sim.group()->waitTimes(waitDown, 5, Request::Direction::DOWN);
+  sim.group()->rideTimes(ride);
+
+  ASSERT_EQ(1u, wait.count());
+  EXPECT_EQ(5000u, wait.percentile(50));
+  EXPECT_EQ(0u, waitDown.count());
+  ASSERT_EQ(1u, ride.count());
+  EXPECT_EQ(13000u - 5000u, ride.max());
+
+  // Two passengers call the car from the same panel. Each car call is tied
+  // to the earliest passenger on board without one: the passenger who
+  // boarded at floor 3 rides to floor 8, the one from floor 5 to floor 9.
+  ElevatorSimulator shared(1);
+  shared.schedule(0, 1, 1, Request::Command::CALL, 5, Request::Direction::UP);
+  shared.schedule(0, 1, 2, Request::Command::CALL, 3, Request::Direction::UP);
+  shared.schedule(20000, 1, 3, Request::Command::GO, 8, Request::Direction::UP);
+  shared.schedule(20000, 1, 4, Request::Command::GO, 9, Request::Direction::UP);
+  shared.run_until(60 * 1000);
+  shared.stop();
+
+  std::map<uint16_t, int64_t> stopped;
+  for (const auto& r : shared.log())
+    if (r.node_addr == 1 && r.state == ElevatorCtrl::State::STOPPED) stopped[r.msg_id] = r.time_ms;
+  ASSERT_EQ(4u, stopped.size());
+
+  LatencyHistogram sharedRide;
+  shared.group()->rideTimes(sharedRide);
+  ASSERT_EQ(2u, sharedRide.count());
+  uint64_t fromFloor3 = static_cast<uint64_t>(stopped[3] - stopped[2]);
+  uint64_t fromFloor5 = static_cast<uint64_t>(stopped[4] - stopped[1]);
+  EXPECT_NEAR(static_cast<double>(std::min(fromFloor3, fromFloor5)), static_cast<double>(sharedRide.percentile(50)),
+              static_cast<double>(std::min(fromFloor3, fromFloor5)) / 32);
+  EXPECT_EQ(std::max(fromFloor3, fromFloor5), sharedRide.max());
+}
+
+
+TEST(ElevatorSimTest, testStatusQuery) {
+  ElevatorSimulator sim(2);
+
+  sim.schedule(0, 1, 1, Request::Command::CALL, 5, Request::Direction::UP);
+  // Queries of car 0 while it is between floor 2 and 3, and after it has
+  // reached floor 5; car 1 has not moved
+  sim.schedule(2500, 7, 10, Request::Command::QUERY, 0, Request::Direction::UP);
+  sim.schedule(7000, 7, 11, Request::Command::QUERY, 0, Request::Direction::UP);
+  sim.schedule(7000, 7, 12, Request::Command::QUERY, 1, Request::Direction::UP);
+  sim.run_until(10 * 1000);
+  sim.stop();
+
+  std::vector<ElevatorSimulator::StatusRecord> answers;
+  for (const auto& r : sim.log())
+    if (r.node_addr == 7) answers.push_back(r);
+
+  ASSERT_EQ(3u, answers.size());
+  EXPECT_EQ(2, answers[0].floor);
+  EXPECT_TRUE(answers[0].state == ElevatorCtrl::State::MOVING);
+  EXPECT_EQ(5, answers[1].floor);
+  EXPECT_TRUE(answers[1].state == ElevatorCtrl::State::STOPPED);
+  EXPECT_EQ(0, answers[2].floor);
+}
+
 } // namespace dsa
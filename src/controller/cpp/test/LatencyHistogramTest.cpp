@@ -0,0 +1,55 @@
+/*
+ * @file   LatencyHistogramTest.cpp
+ * @author Armin Zare Zadeh, ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   Unit test of the latency histograms.
+ */
+
+#include <gtest\gtest.h>
+#include <LatencyHistogram.h>
+
+#include <thread>
+#include <vector>
+
+namespace dsa {
+
+TEST(LatencyHistogramTest, testPercentiles) {
+  LatencyHistogram histogram;
+  for (uint64_t v = 1; v <= 10000; v++)
+    histogram.record(v);
+
+  EXPECT_EQ(10000u, histogram.count());
+  EXPECT_EQ(10000u, histogram.max());
+  EXPECT_DOUBLE_EQ(5000.5, histogram.mean());
+
+  // Every percentile is reported within the relative error of the buckets
+  const double percents[] = {1, 50, 90, 99, 99.9};
+  for (double percent : percents) {
+    double exact = percent * 100;
+    double reported = static_cast<double>(histogram.percentile(percent));
+    EXPECT_GE(reported, exact);
+    EXPECT_LE(reported, exact * (1.0 + 1.0 / (1 << LatencyHistogram::SUB_BUCKET_BITS)));
+  }
+  EXPECT_EQ(10000u, histogram.percentile(100));
+}
+
+
+TEST(LatencyHistogramTest, testMergeThreads) {
+  ShardedHistogram sharded;
+  std::vector<std::thread> threads;
+  for (uint64_t t = 0; t < 4; t++)
+    threads.push_back(std::thread([&sharded, t]() {
+      for (uint64_t i = 0; i < 1000; i++) sharded.record((t + 1) * 1000);
+    }));
+  for (auto& thread : threads) thread.join();
+
+  LatencyHistogram merged;
+  sharded.mergeInto(merged);
+  EXPECT_EQ(4000u, merged.count());
+  EXPECT_EQ(4000u, merged.max());
+  EXPECT_LE(2000u, merged.percentile(50));
+  EXPECT_GT(3000u, merged.percentile(50));
+}
+
+}
@@ -0,0 +1,59 @@
+/*
+ * @file   LoggerTest.cpp
+ * @author Armin Zare Zadeh, ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   Unit test of the asynchronous logger.
+ */
+
+#include <gtest\gtest.h>
+#include <Logger.h>
+
+#include <sstream>
+#include <string>
+#include <thread>
+
+namespace dsa {
+
+TEST(LoggerTest, testDeferredFormatting) {
+  std::ostringstream sink;
+  Logger::instance().setSink(sink);
+
+  // The arguments are copied at the call; the text is only built on flush
+  uint8_t frame[3] = {0x0E, 0x00, 0xAB};
+  std::string text("corrupted");
+  LOG_WARN("Got {} packet: {} bytes {} from {}", text, -3, Logger::bytes(frame, sizeof(frame)), Logger::hex(0x3E8));
+  text = "overwritten";
+  std::thread other([]() { LOG_INFO("from another thread: {}", 1.5); });
+  other.join();
+  Logger::instance().flush();
+
+  std::string out = sink.str();
+  EXPECT_NE(std::string::npos, out.find(" W Got corrupted packet: -3 bytes 0e 00 ab from 3e8\n"));
+  EXPECT_NE(std::string::npos, out.find(" I from another thread: 1.5\n"));
+  EXPECT_LT(out.find("Got corrupted"), out.find("another thread"));
+
+  Logger::instance().setSink(std::cout);
+}
+
+
+TEST(LoggerTest, testDisabledLevel) {
+  std::ostringstream sink;
+  Logger::instance().setSink(sink);
+  Logger::instance().setLevel(LogLevel::INFO);
+
+  // The arguments of a disabled record are not evaluated
+  int evaluated = 0;
+  LOG_DEBUG("dump {}", ++evaluated);
+  LOG_ERROR("error {}", ++evaluated);
+  Logger::instance().flush();
+
+  EXPECT_EQ(1, evaluated);
+  EXPECT_EQ(std::string::npos, sink.str().find("dump"));
+  EXPECT_NE(std::string::npos, sink.str().find(" E error 1\n"));
+
+  Logger::instance().setLevel(LogLevel::DEBUG);
+  Logger::instance().setSink(std::cout);
+}
+
+}
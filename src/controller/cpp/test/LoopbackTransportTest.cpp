@@ -0,0 +1,158 @@
+/*
+ * @file   LoopbackTransportTest.cpp
+ * @author Armin Zare Zadeh, ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   Unit test of the in-process loopback transport, which drives
+ *          the protocol handler and the simulated cars without sockets.
+ */
+
+#include <gtest\gtest.h>
+#include <ElevatorSim.h>
+#include <LoopbackTransport.h>
+
+#include <chrono>
+#include <vector>
+
+namespace dsa {
+
+// Request frame of a requester node
+static std::vector<uint8_t> requestFrame(uint16_t node_addr, uint16_t msg_id, uint8_t floor, Request::Direction direction,
+                                         Request::Command command = Request::Command::CALL) {
+  Net::MsgProtocol::msg_hdr_t header{Net::MsgProtocol::MagicValue, node_addr, Net::NODE_ADDRESS,
+                                     static_cast<Net::MsgProtocol::msg_class_t>(Net::MsgProtocol::MSGTYPE::MSG_DATA),
+                                     msg_id, static_cast<Net::MsgProtocol::msg_len_t>(Net::MsgProtocol::DATA_FRAME_LEN)};
+  Net::MsgProtocol::msg_payload_t payload{0xa, static_cast<uint8_t>(command), floor, static_cast<uint8_t>(direction)};
+  std::vector<uint8_t> frame(Net::MsgProtocol::DATA_FRAME_LEN);
+  Net::MsgProtocol::encode_data_frame(frame.data(), header, payload);
+  return frame;
+}
+
+
+TEST(LoopbackTransportTest, testRequestAck) {
+  auto transport = std::make_shared<Net::LoopbackTransport>(4);
+  Net::NetProtocol net(transport);
+  std::vector<CarCommand> commands;
+  net.getOnNewDataGen()->connect([&](const CarCommand& command) { commands.push_back(command); });
+  Net::LoopbackTransport::Peer panel = transport->connect();
+
+  // A frame split across two sends is handled once it is complete
+  std::vector<uint8_t> frame = requestFrame(7, 3, 2, Request::Direction::UP);
+  ASSERT_TRUE(panel.send(frame.data(), 10));
+  EXPECT_EQ(1u, transport->poll());
+  EXPECT_TRUE(commands.empty());
+  ASSERT_TRUE(panel.send(frame.data() + 10, frame.size() - 10));
+  EXPECT_EQ(1u, transport->poll());
+  ASSERT_EQ(1u, commands.size());
+  EXPECT_EQ(2, commands[0].floor);
+
+  uint8_t ack[Net::MsgProtocol::HDR_LEN];
+  ASSERT_EQ(sizeof(ack), panel.receive(ack, sizeof(ack)));
+  Net::MsgProtocol::msg_hdr_t header = Net::MsgProtocol::decode_header(ack);
+  EXPECT_EQ(0xC1, header.msg_class);
+  EXPECT_EQ(3, header.msg_id);
+
+  // The status goes back over the learned route until the panel hangs up
+  net.input_data_consumer(CarStatus{7, 3, 0, 2, CarState::STOPPED, Request::Direction::UP});
+  EXPECT_TRUE(panel.pending() == Net::MsgProtocol::DATA_FRAME_LEN);
+  panel.close();
+  EXPECT_EQ(1u, transport->poll());
+  EXPECT_EQ(0u, transport->size());
+  net.input_data_consumer(CarStatus{7, 3, 0, 2, CarState::STOPPED, Request::Direction::UP});
+  EXPECT_TRUE(panel.pending() == Net::MsgProtocol::DATA_FRAME_LEN);
+  EXPECT_FALSE(panel.send(frame));
+}
+
+
+TEST(LoopbackTransportTest, testBadQueryNak) {
+  ElevatorSimulator sim(2);
+  auto transport = std::make_shared<Net::LoopbackTransport>(4);
+  auto net = std::make_shared<Net::NetProtocol>(transport, sim.group()->size());
+  net->getOnNewDataGen()->connect_member<ElevatorGroupCtrl>(sim.group(), &ElevatorGroupCtrl::input_data_consumer);
+  std::vector<CarCommand> commands;
+  net->getOnNewDataGen()->connect([&](const CarCommand& command) { commands.push_back(command); });
+  Net::LoopbackTransport::Peer panel = transport->connect();
+
+  // A query of a car the group does not have, an unknown command and a call
+  // arrive in one write; the first two are rejected and the call is served
+  std::vector<uint8_t> bytes = requestFrame(7, 1, 2, Request::Direction::UP, Request::Command::QUERY);
+  std::vector<uint8_t> unknown = requestFrame(7, 2, 0, Request::Direction::UP, static_cast<Request::Command>(3));
+  std::vector<uint8_t> call = requestFrame(7, 3, 5, Request::Direction::UP);
+  bytes.insert(bytes.end(), unknown.begin(), unknown.end());
+  bytes.insert(bytes.end(), call.begin(), call.end());
+  ASSERT_TRUE(panel.send(bytes));
+  EXPECT_EQ(1u, transport->poll());
+
+  ASSERT_EQ(1u, commands.size());
+  EXPECT_EQ(Request::Command::CALL, commands[0].cmd);
+  EXPECT_EQ(5, commands[0].floor);
+
+  uint8_t replies[3][Net::MsgProtocol::HDR_LEN];
+  ASSERT_EQ(sizeof(replies), panel.receive(replies[0], sizeof(replies)));
+  const uint8_t expected[3][2] = {{0x81, 1}, {0x81, 2}, {0xC1, 3}};
+  for (int i = 0; i < 3; i++) {
+    Net::MsgProtocol::msg_hdr_t header = Net::MsgProtocol::decode_header(replies[i]);
+    EXPECT_EQ(expected[i][0], header.msg_class);
+    EXPECT_EQ(expected[i][1], header.msg_id);
+  }
+  sim.stop();
+}
+
+
+// Thousands of panels call the cars through the protocol handler on the
+// virtual clock. Returns a digest of all bytes the panels have received.
+static uint64_t simulatePanels(size_t numPanels) {
+  const size_t PANELS_PER_EVENT = 10;
+  ElevatorSimulator sim(4);
+  auto transport = std::make_shared<Net::LoopbackTransport>(numPanels);
+  auto net = std::make_shared<Net::NetProtocol>(transport, sim.group()->size());
+  net->getOnNewDataGen()->connect_member<ElevatorGroupCtrl>(sim.group(), &ElevatorGroupCtrl::input_data_consumer);
+  sim.group()->getOnNewDataGen()->connect_member<Net::NetProtocol>(net, &Net::NetProtocol::input_data_consumer);
+
+  std::vector<Net::LoopbackTransport::Peer> panels;
+  for (size_t i = 0; i < numPanels; i++)
+    panels.push_back(transport->connect());
+
+  // Every 100 ms ten panels call a car, and the calls are handled at once
+  for (size_t first = 0; first < numPanels; first += PANELS_PER_EVENT) {
+    sim.schedule(static_cast<int64_t>(first / PANELS_PER_EVENT) * 100, [&, first]() {
+      for (size_t i = first; i < first + PANELS_PER_EVENT && i < numPanels; i++) {
+        Request::Direction direction = (i % 2 == 0) ? Request::Direction::UP : Request::Direction::DOWN;
+        panels[i].send(requestFrame(static_cast<uint16_t>(i + 1), 1, static_cast<uint8_t>(1 + i % 15), direction));
+      }
+      transport->poll();
+    });
+  }
+  sim.run_until(3600 * 1000);
+  sim.stop();
+
+  // Every panel got its ACK and, at the end, the arrival of a car
+  uint64_t digest = 14695981039346656037ull;
+  for (auto& panel : panels) {
+    std::vector<uint8_t> bytes(panel.pending());
+    panel.receive(bytes.data(), bytes.size());
+    EXPECT_GE(bytes.size(), Net::MsgProtocol::HDR_LEN + Net::MsgProtocol::DATA_FRAME_LEN);
+    if (bytes.size() < Net::MsgProtocol::HDR_LEN + Net::MsgProtocol::DATA_FRAME_LEN)
+      continue;
+    EXPECT_EQ(0xC1, bytes[offsetof(Net::MsgProtocol::msg_hdr_t, msg_class)]);
+    const uint8_t* last = &bytes[bytes.size() - Net::MsgProtocol::DATA_FRAME_LEN];
+    EXPECT_EQ(static_cast<uint8_t>(CarState::STOPPED), last[Net::MsgProtocol::DATA_FRAME_LEN - Net::MsgProtocol::CRC_LEN - 1]);
+    for (uint8_t b : bytes)
+      digest = (digest ^ b) * 1099511628211ull;
+  }
+  return digest;
+}
+
+
+TEST(LoopbackTransportTest, testDeterministicPanels) {
+  Logger::instance().setLevel(LogLevel::WARN);
+
+  auto start = std::chrono::steady_clock::now();
+  uint64_t digest = simulatePanels(20000);
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(30));
+
+  // The same traffic gets exactly the same replies
+  EXPECT_EQ(digest, simulatePanels(20000));
+}
+
+}
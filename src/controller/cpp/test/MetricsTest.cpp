@@ -0,0 +1,92 @@
+/*
+ * @file   MetricsTest.cpp
+ * @author Armin Zare Zadeh, ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   Unit test of the metrics registry and its exporter.
+ */
+
+#include <gtest\gtest.h>
+#include <MetricsExporter.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+namespace dsa {
+
+TEST(MetricsTest, testPrometheusText) {
+  MetricsRegistry registry;
+  auto calls = registry.counter("test_requests_total", "Requests.", "command=\"call\"");
+  auto depth = registry.gauge("test_depth", "Depth.");
+  auto loop = registry.summary("test_loop_seconds", "Loop time.", "driver=\"0\"");
+
+  std::thread other([&registry]() { registry.counter("test_requests_total", "Requests.", "command=\"call\"")->add(2); });
+  other.join();
+  calls->add();
+  depth->set(7);
+  loop->record(2000);
+
+  std::string text = registry.text();
+  EXPECT_NE(std::string::npos, text.find("# TYPE test_requests_total counter\ntest_requests_total{command=\"call\"} 3\n"));
+  EXPECT_NE(std::string::npos, text.find("# TYPE test_depth gauge\ntest_depth 7\n"));
+  EXPECT_NE(std::string::npos, text.find("test_loop_seconds{driver=\"0\",quantile=\"0.99\"} 2e-06\n"));
+  EXPECT_NE(std::string::npos, text.find("test_loop_seconds_count{driver=\"0\"} 1\n"));
+  EXPECT_THROW(registry.gauge("test_requests_total", "Requests."), std::invalid_argument);
+
+  // The series of a destroyed owner is no longer exported
+  depth = nullptr;
+  EXPECT_EQ(std::string::npos, registry.text().find("test_depth"));
+}
+
+
+TEST(MetricsTest, testExport) {
+  const int PORT = 19102;
+  MetricsRegistry registry;
+  auto scrapes = registry.counter("test_scrapes_total", "Scrapes.");
+  scrapes->add(5);
+
+  Net::MetricsExporter exporter(PORT, "/elevator_metrics_test", registry);
+  std::thread thread([&exporter]() { exporter.run(); });
+
+  // Scrape the HTTP port once it is listening
+  std::string response;
+  for (int attempt = 0; attempt < 100 && response.find("\r\n\r\n") == std::string::npos; attempt++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    timeval timeout{1, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(PORT);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) {
+      const char request[] = "GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n";
+      ASSERT_EQ(static_cast<ssize_t>(sizeof(request) - 1), send(fd, request, sizeof(request) - 1, 0));
+      char buffer[4096];
+      ssize_t n;
+      while (response.find("test_scrapes_total 5\n") == std::string::npos && (n = recv(fd, buffer, sizeof(buffer), 0)) > 0)
+        response.append(buffer, static_cast<size_t>(n));
+    }
+    ::close(fd);
+  }
+  EXPECT_EQ(0u, response.find("HTTP/1.1 200 OK\r\n"));
+  EXPECT_NE(std::string::npos, response.find("\r\n\r\n# HELP test_scrapes_total Scrapes.\n"));
+
+  // The shared memory page carries the same text
+  std::string page;
+  for (int attempt = 0; attempt < 100 && page.empty(); attempt++) {
+    try {
+      page = Net::MetricsPage::read("/elevator_metrics_test");
+    } catch (const std::runtime_error&) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  }
+  EXPECT_NE(std::string::npos, page.find("test_scrapes_total 5\n"));
+
+  exporter.stop();
+  thread.join();
+  EXPECT_THROW(Net::MetricsPage::read("/elevator_metrics_test"), std::runtime_error);
+}
+
+}
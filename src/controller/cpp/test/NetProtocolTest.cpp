@@ -0,0 +1,273 @@
+/*
+ * @file   NetProtocolTest.cpp
+ * @author Armin Zare Zadeh, ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   Unit test of the messaging protocol stack.
+ */
+
+#include <gtest\gtest.h>
+#include <NetProtocol.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace dsa {
+
+// Request frame as it is sent by the requester: header, payload and CRC
+static std::vector<uint8_t> requestFrame(uint16_t msg_id, uint8_t floor, uint8_t command = 0x01) {
+  std::vector<uint8_t> frame{0x0E, 0x00, 0x01, 0x03, 0xE8, 0x02,
+                             static_cast<uint8_t>(msg_id >> 8), static_cast<uint8_t>(msg_id), 0x00, 0x17,
+                             0, 0, 0, 0, 0, 0, 0, 0, command, floor, 0x01};
+  uint16_t crc = Net::crc16(frame);
+  frame.push_back(static_cast<uint8_t>(crc >> 8));
+  frame.push_back(static_cast<uint8_t>(crc));
+  return frame;
+}
+
+static void append(ByteRing& rx, const std::vector<uint8_t>& bytes) {
+  for (auto b : bytes) {
+    size_t len;
+    *rx.writePtr(len) = b;
+    rx.commit(1);
+  }
+}
+
+
+TEST(NetProtocolTest, testFrameReassembly) {
+  ByteRing rx(64);
+  uint8_t buffer[Net::MsgProtocol::MAX_FRAME_LEN];
+  size_t len;
+  std::vector<uint8_t> first = requestFrame(1, 5);
+  std::vector<uint8_t> second = requestFrame(2, 7);
+
+  // Garbage in front of a frame, then two coalesced frames of which the
+  // second one is split across two reads
+  append(rx, {0x55, 0x0E, 0x00});
+  append(rx, first);
+  append(rx, std::vector<uint8_t>(second.begin(), second.begin() + 12));
+
+  ASSERT_NE(0u, len = Net::MsgProtocol::extract_frame(rx, buffer));
+  EXPECT_EQ(first, std::vector<uint8_t>(buffer, buffer + len));
+  EXPECT_EQ(0u, Net::MsgProtocol::extract_frame(rx, buffer));
+  EXPECT_EQ(12u, rx.size());
+
+  append(rx, std::vector<uint8_t>(second.begin() + 12, second.end()));
+  ASSERT_NE(0u, len = Net::MsgProtocol::extract_frame(rx, buffer));
+  EXPECT_EQ(second, std::vector<uint8_t>(buffer, buffer + len));
+  EXPECT_TRUE(rx.empty());
+}
+
+
+TEST(NetProtocolTest, testDataFrameEncoding) {
+  Net::MsgProtocol::msg_hdr_t header{Net::MsgProtocol::MagicValue, 0x03E8, 0x0001, 0x02, 0x0102, 23};
+  Net::MsgProtocol::msg_payload_t payload{0x1122334455667788, 3, 9, 2};
+  uint8_t buffer[Net::MsgProtocol::DATA_FRAME_LEN];
+  Net::MsgProtocol::encode_data_frame(buffer, header, payload);
+
+  // All fields are in network byte order
+  std::vector<uint8_t> expected{0x0E, 0x03, 0xE8, 0x00, 0x01, 0x02, 0x01, 0x02, 0x00, 0x17,
+                                0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x03, 0x09, 0x02};
+  EXPECT_EQ(expected, std::vector<uint8_t>(buffer, buffer + expected.size()));
+  EXPECT_EQ(Net::crc16(expected), Net::MsgProtocol::load16(buffer + expected.size()));
+
+  auto decodedHeader = Net::MsgProtocol::decode_header(buffer);
+  auto decodedPayload = Net::MsgProtocol::decode_payload(buffer + Net::MsgProtocol::HDR_LEN);
+  EXPECT_EQ(0x0102, decodedHeader.msg_id);
+  EXPECT_EQ(23, decodedHeader.len);
+  EXPECT_EQ(0x1122334455667788u, decodedPayload.timetag);
+  EXPECT_EQ(9, decodedPayload.floor_num);
+}
+
+
+// Bit by bit reference of the CRC, as implemented by the requester
+static uint16_t crc16Bitwise(const std::vector<uint8_t>& data) {
+  uint16_t crc = 0xFFFF;
+  for (auto b : data) {
+    for (int i = 0; i < 8; i++, b >>= 1)
+      crc = ((crc ^ b) & 0x0001) ? static_cast<uint16_t>((crc >> 1) ^ Net::POLY) : static_cast<uint16_t>(crc >> 1);
+  }
+  crc = static_cast<uint16_t>(~crc);
+  return static_cast<uint16_t>((crc << 8) | (crc >> 8));
+}
+
+
+TEST(NetProtocolTest, testCrc16Conformance) {
+  // Values of crc16() in ElevatorMsgProtocol.py
+  std::vector<uint8_t> all(256);
+  for (int i = 0; i < 256; i++) all[i] = static_cast<uint8_t>(i);
+  EXPECT_EQ(0x0000, Net::crc16(std::vector<uint8_t>()));
+  EXPECT_EQ(0x6E90, Net::crc16(std::vector<uint8_t>{'1', '2', '3', '4', '5', '6', '7', '8', '9'}));
+  EXPECT_EQ(0x5E88, Net::crc16(std::vector<uint8_t>{0x0E, 0x00, 0x01, 0x03, 0xE8, 0x02, 0x00, 0x07, 0x00, 0x17,
+                                                    0, 0, 0, 0, 0, 0, 0, 0, 0x01, 0x02, 0x01}));
+  EXPECT_EQ(0x3C30, Net::crc16(all));
+
+  // Every length hits a different split between the sliced and bytewise steps
+  std::vector<uint8_t> data;
+  for (int len = 0; len < 64; len++) {
+    EXPECT_EQ(crc16Bitwise(data), Net::crc16(data));
+    data.push_back(static_cast<uint8_t>(len * 37 + 11));
+  }
+}
+
+
+TEST(NetProtocolTest, testCrcVerification) {
+  std::weak_ptr<Net::TransportSocket::ClientSocket> noSocket;
+  CarCommand command;
+  std::vector<uint8_t> frame = requestFrame(7, 2);
+
+  EXPECT_TRUE(Net::MsgProtocol::handle(noSocket, frame.data(), frame.size(), 1, command));
+  EXPECT_EQ(2, command.floor);
+
+  frame[19] = 3;
+  EXPECT_FALSE(Net::MsgProtocol::handle(noSocket, frame.data(), frame.size(), 1, command));
+}
+
+
+
+TEST(NetProtocolTest, testPayloadCheck) {
+  std::weak_ptr<Net::TransportSocket::ClientSocket> noSocket;
+  CarCommand command;
+
+  // A query must name one of the cars; unknown commands are rejected
+  std::vector<uint8_t> query = requestFrame(1, 1, 4);
+  EXPECT_TRUE(Net::MsgProtocol::handle(noSocket, query.data(), query.size(), 2, command));
+  EXPECT_EQ(Request::Command::QUERY, command.cmd);
+
+  query = requestFrame(2, 2, 4);
+  EXPECT_FALSE(Net::MsgProtocol::handle(noSocket, query.data(), query.size(), 2, command));
+
+  std::vector<uint8_t> unknown = requestFrame(3, 2, 3);
+  EXPECT_FALSE(Net::MsgProtocol::handle(noSocket, unknown.data(), unknown.size(), 2, command));
+}
+
+
+
+TEST(NetProtocolTest, testSendQueueOverflow) {
+  int fds[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  Net::TransportSocket server(0);
+  Net::TransportSocket::ClientSocket client(fds[0], server);
+
+  // A reliable frame is never displaced; status frames make room for newer ones
+  uint8_t frame[4] = {0xAA, 0, 0, 0};
+  client.write(frame, sizeof(frame));
+  for (int i = 0; i < 200; i++) {
+    frame[0] = static_cast<uint8_t>(i);
+    client.write(frame, sizeof(frame), true);
+  }
+  EXPECT_TRUE(client.txQueued() == Net::TransportSocket::ClientSocket::TX_QUEUE_CAPACITY);
+  EXPECT_EQ(200u + 1u - client.txQueued(), client.txDropped());
+
+  // The queue goes out in gather writes, oldest frames first
+  EXPECT_TRUE(client.flush());
+  EXPECT_EQ(0u, client.txQueued());
+  uint8_t rx[4];
+  ASSERT_EQ(4, read(fds[1], rx, sizeof(rx)));
+  EXPECT_EQ(0xAA, rx[0]);
+  ASSERT_EQ(4, read(fds[1], rx, sizeof(rx)));
+  EXPECT_EQ(200 - 127, rx[0]);
+
+  close(fds[0]);
+  close(fds[1]);
+}
+
+
+
+TEST(NetProtocolTest, testListenInterrupt) {
+  Net::TransportSocket server(0);
+  std::atomic<bool> stop(false);
+
+  // Without any timer the reactor waits forever, so only the interrupt ends
+  // the wait; the port is released and listening starts again right away
+  for (int round = 0; round < 2; round++) {
+    stop = false;
+    std::thread listener([&]() { server.listen([&]() -> bool { return stop; }); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    auto start = std::chrono::steady_clock::now();
+    stop = true;
+    server.interrupt();
+    listener.join();
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(200));
+  }
+}
+
+
+
+TEST(NetProtocolTest, testRoutingTable) {
+  Net::TransportSocket server(0);
+  auto panelA = std::make_shared<Net::TransportSocket::ClientSocket>(5, server);
+  auto panelB = std::make_shared<Net::TransportSocket::ClientSocket>(6, server);
+  Net::RoutingTable routes;
+
+  routes.learn(0x0E00, panelA);
+  routes.learn(0x0E01, panelB);
+  EXPECT_EQ(panelA, routes.lookup(0x0E00).lock());
+  EXPECT_EQ(panelB, routes.lookup(0x0E01).lock());
+  EXPECT_TRUE(routes.lookup(0x0E02).expired());
+
+  // A node which moved keeps its new route when its old connection closes
+  routes.learn(0x0E00, panelB);
+  routes.forget(panelA->fileDescriptor());
+  EXPECT_EQ(panelB, routes.lookup(0x0E00).lock());
+
+  // A node moving back and forth is listed once, by its current connection
+  for (int i = 0; i < 10; i++) {
+    routes.learn(0x0E00, panelA);
+    routes.learn(0x0E00, panelB);
+  }
+  EXPECT_EQ(0u, routes.size(panelA->fileDescriptor()));
+  EXPECT_EQ(2u, routes.size(panelB->fileDescriptor()));
+
+  routes.forget(panelB->fileDescriptor());
+  EXPECT_EQ(0u, routes.size());
+}
+
+
+
+TEST(NetProtocolTest, testStatusFanOut) {
+  int lobbyFds[2], floorFds[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, lobbyFds));
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, floorFds));
+  Net::TransportSocket server(0);
+  auto lobby = std::make_shared<Net::TransportSocket::ClientSocket>(lobbyFds[0], server);
+  auto floor = std::make_shared<Net::TransportSocket::ClientSocket>(floorFds[0], server);
+
+  Net::NetProtocol net;
+  net.subscribers().subscribe(lobby, 0x3);
+  net.subscribers().subscribe(floor, 0x2);
+
+  CarStatus status{Net::MsgProtocol::BROADCAST_ADDRESS, 0, 1, 4, CarState::MOVING, Request::Direction::DOWN};
+  net.publish(status);
+  status.car_id = 0;
+  net.publish(status);
+  EXPECT_EQ(2u, lobby->txQueued());
+  EXPECT_EQ(1u, floor->txQueued());
+
+  // Both subscribers of car 1 get the same frame
+  EXPECT_TRUE(lobby->flush());
+  EXPECT_TRUE(floor->flush());
+  uint8_t lobbyFrame[Net::MsgProtocol::STATUS_FRAME_LEN];
+  uint8_t floorFrame[Net::MsgProtocol::STATUS_FRAME_LEN];
+  ASSERT_EQ(sizeof(lobbyFrame), static_cast<size_t>(read(lobbyFds[1], lobbyFrame, sizeof(lobbyFrame))));
+  ASSERT_EQ(sizeof(floorFrame), static_cast<size_t>(read(floorFds[1], floorFrame, sizeof(floorFrame))));
+  EXPECT_EQ(0, memcmp(lobbyFrame, floorFrame, sizeof(lobbyFrame)));
+  EXPECT_TRUE(Net::MsgProtocol::crc_check(lobbyFrame, sizeof(lobbyFrame)));
+  EXPECT_EQ(1, lobbyFrame[Net::MsgProtocol::HDR_LEN]);
+  EXPECT_EQ(4, lobbyFrame[Net::MsgProtocol::HDR_LEN + 1]);
+
+  // A closed connection no longer receives the status
+  net.subscribers().forget(lobby->fileDescriptor());
+  status.car_id = 1;
+  net.publish(status);
+  EXPECT_EQ(0u, lobby->txQueued());
+  EXPECT_EQ(1u, floor->txQueued());
+
+  for (int fd : {lobbyFds[0], lobbyFds[1], floorFds[0], floorFds[1]})
+    close(fd);
+}
+
+}
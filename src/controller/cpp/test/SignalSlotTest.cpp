@@ -0,0 +1,79 @@
+/*
+ * @file   SignalSlotTest.cpp
+ * @author Armin Zare Zadeh, ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   Unit test of the signal/slot observer pattern.
+ */
+
+#include <gtest\gtest.h>
+#include <signal_slot.h>
+
+#include <thread>
+#include <tuple>
+#include <vector>
+
+namespace dsa {
+
+TEST(SignalSlotTest, testConnectDisconnect) {
+  signal_slot<int&> signal;
+  std::vector<int> calls;
+  int first = signal.connect([&calls](int& v) { calls.push_back(v); });
+  // A slot may disconnect itself while the signal is being emitted
+  int second = 0;
+  second = signal.connect([&](int& v) { calls.push_back(-v); signal.disconnect(second); });
+
+  int value = 1;
+  signal.emit(value);
+  value = 2;
+  signal.emit(value);
+  signal.disconnect(first);
+  signal.emit(value);
+
+  EXPECT_EQ((std::vector<int>{1, -1, 2}), calls);
+}
+
+
+TEST(SignalSlotTest, testQueuedDelivery) {
+  signal_slot<std::tuple<uint16_t, uint8_t>&> signal;
+  auto mailbox = std::make_shared<signal_mailbox<std::tuple<uint16_t, uint8_t>&>>(4);
+  std::vector<uint16_t> received;
+  std::thread::id receiver;
+  signal.connect_queued(mailbox, [&](std::tuple<uint16_t, uint8_t>& t) {
+    received.push_back(std::get<0>(t));
+    receiver = std::this_thread::get_id();
+  });
+
+  // The arguments are copied at emit time; the slot runs on the dispatching
+  // thread
+  std::thread emitter([&signal]() {
+    for (uint16_t i = 1; i <= 5; i++) {
+      std::tuple<uint16_t, uint8_t> t(i, 0);
+      signal.emit(t);
+    }
+  });
+  emitter.join();
+  EXPECT_TRUE(received.empty());
+
+  EXPECT_EQ(4u, mailbox->dispatch());
+  EXPECT_EQ((std::vector<uint16_t>{1, 2, 3, 4}), received);
+  EXPECT_EQ(std::this_thread::get_id(), receiver);
+  EXPECT_EQ(1u, mailbox->dropped());
+}
+
+
+TEST(SignalSlotTest, testQueuedAfterSignalDestroyed) {
+  auto mailbox = std::make_shared<signal_mailbox<int>>(4);
+  std::vector<int> received;
+  {
+    signal_slot<int> signal;
+    signal.connect_queued(mailbox, [&received](int v) { received.push_back(v); });
+    signal.emit(7);
+  }
+
+  // The queued call keeps its slot alive
+  EXPECT_EQ(1u, mailbox->dispatch());
+  EXPECT_EQ((std::vector<int>{7}), received);
+}
+
+}
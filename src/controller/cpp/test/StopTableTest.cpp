@@ -0,0 +1,66 @@
+/*
+ * @file   StopTableTest.cpp
+ * @author Armin Zare Zadeh, ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   Unit test of the per-floor stop table.
+ */
+
+#include <gtest\gtest.h>
+#include <StopTable.h>
+
+#include <vector>
+
+namespace dsa {
+
+static Request hallCall(uint16_t msg_id, uint8_t floor, Request::Direction direction) {
+  return Request(1, msg_id, 0, Request::Command::CALL, floor, direction);
+}
+
+
+TEST(StopTableTest, testMergeRepeatedCalls) {
+  StopTable stops;
+  EXPECT_TRUE(stops.add(hallCall(1, 7, Request::Direction::UP)));
+  EXPECT_FALSE(stops.add(hallCall(2, 7, Request::Direction::UP)));
+  EXPECT_TRUE(stops.add(hallCall(3, 7, Request::Direction::DOWN)));
+  EXPECT_EQ(2u, stops.size());
+
+  // Serving the up stop reports both merged requests and leaves the down stop
+  std::vector<Request> served;
+  stops.serve(7, Request::Direction::UP, served);
+  ASSERT_EQ(2u, served.size());
+  EXPECT_EQ(1, served[0].msg_id_);
+  EXPECT_EQ(2, served[1].msg_id_);
+  EXPECT_EQ(1u, stops.size());
+  EXPECT_TRUE(stops.has(7, StopTable::Kind::DOWN));
+}
+
+
+TEST(StopTableTest, testLookSweep) {
+  StopTable stops;
+  stops.add(hallCall(1, 2, Request::Direction::UP));
+  stops.add(hallCall(2, 9, Request::Direction::UP));
+  stops.add(hallCall(3, 200, Request::Direction::DOWN));
+  stops.add(hallCall(4, 70, Request::Direction::DOWN));
+  stops.add(Request(1, 5, 0, Request::Command::GO, 1, Request::Direction::UP));
+
+  // Car at floor 5 sweeping up: up calls ahead first, then it turns around
+  // at the highest down call and sweeps down to the car call and the up call
+  // left behind
+  uint8_t location = 5;
+  Request::Direction direction = Request::Direction::UP;
+  std::vector<int> order;
+  std::vector<Request> served;
+  while (!stops.empty()) {
+    StopTable::Stop stop = stops.next(location, direction);
+    ASSERT_GE(stop.floor, 0);
+    order.push_back(stop.floor);
+    location = static_cast<uint8_t>(stop.floor);
+    direction = stop.direction;
+    stops.serve(location, direction, served);
+  }
+  EXPECT_EQ((std::vector<int>{9, 200, 70, 1, 2}), order);
+}
+
+
+} // namespace dsa
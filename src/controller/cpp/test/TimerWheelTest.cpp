@@ -0,0 +1,57 @@
+/*
+ * @file   TimerWheelTest.cpp
+ * @author Armin Zare Zadeh, ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   Unit test of the hierarchical timer wheel.
+ */
+
+#include <gtest\gtest.h>
+#include <TimerWheel.h>
+
+#include <vector>
+#include <memory>
+
+namespace dsa {
+
+TEST(TimerWheelTest, testExpiryOrder) {
+  TimerWheel wheel(0);
+  std::vector<int> fired;
+  int64_t expiries[] = {5000000, 70, 3, 4096, 70, 300000};
+  std::vector<std::unique_ptr<TimerWheel::Timer>> timers;
+  for (int i = 0; i < 6; i++) {
+    timers.emplace_back(new TimerWheel::Timer([&fired, i]() { fired.push_back(i); }));
+    wheel.schedule(*timers.back(), expiries[i]);
+  }
+  wheel.cancel(*timers[3]);
+  EXPECT_EQ(5u, wheel.size());
+
+  // Jumping from expiry to expiry never fires a timer early
+  size_t count = 0;
+  while (!wheel.empty()) {
+    int64_t next = wheel.next_expiry_ms();
+    count += wheel.advance(next);
+    for (int i : fired) EXPECT_LE(expiries[i], next);
+  }
+  EXPECT_EQ(5u, count);
+  // Timers of the same tick fire in the order they were scheduled
+  EXPECT_EQ(std::vector<int>({2, 1, 4, 5, 0}), fired);
+}
+
+
+TEST(TimerWheelTest, testRearmFromCallback) {
+  TimerWheel wheel(100);
+  int ticks = 0;
+  TimerWheel::Timer timer([&]() {
+    if (++ticks < 10) wheel.schedule(timer, timer.expiry_ms() + 1000);
+  });
+  wheel.schedule(timer, 1100);
+
+  // An overdue periodic timer catches up within a single advance
+  wheel.advance(20000);
+  EXPECT_EQ(10, ticks);
+  EXPECT_FALSE(timer.pending());
+  EXPECT_TRUE(wheel.next_expiry_ms() == TimerWheel::NEVER);
+}
+
+}
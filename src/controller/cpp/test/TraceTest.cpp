@@ -0,0 +1,99 @@
+/*
+ * @file   TraceTest.cpp
+ * @author Armin Zare Zadeh, ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   Unit test of the event trace and its timeline decoder.
+ */
+
+#include <gtest\gtest.h>
+#include <ElevatorSim.h>
+#include <Trace.h>
+
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dsa {
+
+static std::string tracePath() {
+  return "/tmp/elevator_test_" + std::to_string(getpid()) + ".trace";
+}
+
+
+TEST(TraceTest, testRingWrap) {
+  std::string path = tracePath();
+  Tracer::instance().open(path);
+
+  // The ring keeps the newest events of a thread
+  std::thread floors([]() {
+    for (uint32_t i = 0; i < Tracer::RING_EVENTS + 10; i++)
+      Tracer::event(TraceEvent::Type::FLOOR, 1, 0, static_cast<uint16_t>(i), static_cast<uint8_t>(i), 0);
+  });
+  floors.join();
+  Tracer::event(TraceEvent::Type::ACK, 0, 0x3E8, 7, 0, 0);
+  Tracer::instance().close();
+
+  TraceReader reader(path);
+  std::remove(path.c_str());
+  ASSERT_EQ(Tracer::RING_EVENTS + 1, reader.records().size());
+  EXPECT_EQ(10, reader.records().front().event.msgId);
+  EXPECT_TRUE(reader.records().back().event.type == TraceEvent::Type::ACK);
+  EXPECT_NE(reader.records().front().tid, reader.records().back().tid);
+  for (size_t i = 1; i < reader.records().size(); i++)
+    EXPECT_LE(reader.records()[i - 1].event.ns, reader.records()[i].event.ns);
+}
+
+
+TEST(TraceTest, testRestartKeepsTrace) {
+  std::string path = tracePath();
+  Tracer::instance().open(path);
+  Tracer::event(TraceEvent::Type::ACK, 0, 0x3E8, 7, 0, 0);
+  Tracer::instance().close();
+
+  // A restart moves the trace of the former run aside instead of wiping it
+  Tracer::instance().open(path);
+  Tracer::event(TraceEvent::Type::NAK, 0, 0x3E8, 8, 0, 0);
+  Tracer::instance().close();
+
+  TraceReader former(path + ".1");
+  TraceReader current(path);
+  std::remove((path + ".1").c_str());
+  std::remove(path.c_str());
+  ASSERT_EQ(1u, former.records().size());
+  EXPECT_EQ(7, former.records().front().event.msgId);
+  ASSERT_EQ(1u, current.records().size());
+  EXPECT_EQ(8, current.records().front().event.msgId);
+}
+
+
+TEST(TraceTest, testSimulationTimeline) {
+  std::string path = tracePath();
+  Tracer::instance().open(path);
+  {
+    ElevatorSimulator sim(1);
+    sim.schedule(0, 1, 1, Request::Command::CALL, 2, Request::Direction::UP);
+    sim.run_until(10 * 1000);
+    sim.stop();
+  }
+  Tracer::instance().close();
+
+  TraceReader reader(path);
+  std::remove(path.c_str());
+  std::vector<TraceEvent::Type> types;
+  for (const auto& r : reader.records()) types.push_back(r.event.type);
+  std::vector<TraceEvent::Type> expected{TraceEvent::Type::ACCEPTED, TraceEvent::Type::QUEUED, TraceEvent::Type::DEPART,
+                                         TraceEvent::Type::FLOOR, TraceEvent::Type::FLOOR, TraceEvent::Type::DOOR_OPEN,
+                                         TraceEvent::Type::DOOR_CLOSE};
+  EXPECT_TRUE(types == expected);
+
+  std::ostringstream json;
+  reader.writeChromeJson(json);
+  EXPECT_NE(std::string::npos, json.str().find("\"name\":\"moving\""));
+  EXPECT_NE(std::string::npos, json.str().find("\"name\":\"doors open\""));
+  EXPECT_EQ(json.str().size() - 4, json.str().rfind("\n]}\n"));
+}
+
+}
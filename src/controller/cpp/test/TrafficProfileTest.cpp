@@ -0,0 +1,56 @@
+/*
+ * @file   TrafficProfileTest.cpp
+ * @author Armin Zare Zadeh, ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   Unit test of the passenger traffic profiles.
+ */
+
+#include <gtest\gtest.h>
+#include <TrafficProfile.h>
+
+namespace dsa {
+
+TEST(TrafficProfileTest, testPoissonRate) {
+  TrafficProfile profile(TrafficProfile::Kind::INTERFLOOR, 10, 200.0, 1);
+
+  // 200 passengers per second arrive 5 ms apart on average
+  const int n = 100000;
+  double sum = 0;
+  for (int i = 0; i < n; i++)
+    sum += static_cast<double>(profile.nextGapNs());
+  EXPECT_NEAR(5e6, sum / n, 5e4);
+
+  EXPECT_THROW(TrafficProfile(TrafficProfile::Kind::LUNCH, 2, 1.0, 1), std::invalid_argument);
+  EXPECT_THROW(TrafficProfile(TrafficProfile::Kind::LUNCH, 1, 1.0, 1), std::invalid_argument);
+  EXPECT_THROW(TrafficProfile(TrafficProfile::Kind::LUNCH, 16, 0.0, 1), std::invalid_argument);
+  EXPECT_THROW(TrafficProfile::parse("rush-hour"), std::invalid_argument);
+}
+
+
+TEST(TrafficProfileTest, testPassengerMix) {
+  const int n = 100000;
+  int incoming = 0, outgoing = 0, interfloor = 0;
+  TrafficProfile profile(TrafficProfile::parse("up-peak"), 10, 1.0, 7);
+  for (int i = 0; i < n; i++) {
+    TrafficProfile::Passenger p = profile.next();
+    ASSERT_NE(p.origin, p.destination);
+    ASSERT_LT(p.origin, 10);
+    ASSERT_LT(p.destination, 10);
+    if (p.origin == 0) incoming++;
+    else if (p.destination == 0) outgoing++;
+    else interfloor++;
+  }
+  EXPECT_NEAR(0.85, static_cast<double>(incoming) / n, 0.01);
+  EXPECT_NEAR(0.05, static_cast<double>(outgoing) / n, 0.01);
+  EXPECT_NEAR(0.10, static_cast<double>(interfloor) / n, 0.01);
+
+  // Interfloor passengers never use the lobby
+  TrafficProfile other(TrafficProfile::Kind::INTERFLOOR, 10, 1.0, 7);
+  for (int i = 0; i < 1000; i++) {
+    TrafficProfile::Passenger p = other.next();
+    ASSERT_TRUE(p.origin != 0 && p.destination != 0);
+  }
+}
+
+}
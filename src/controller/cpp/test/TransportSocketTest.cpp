@@ -0,0 +1,96 @@
+/*
+ * @file   TransportSocketTest.cpp
+ * @author Armin Zare Zadeh, ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   Unit test of the transport socket reactor.
+ */
+
+#include <gtest\gtest.h>
+#include <TransportSocket.h>
+
+#include <sys/resource.h>
+#include <fcntl.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace dsa {
+
+// Connects a client socket to a port of the local host
+static bool connectLocal(int fd, int port) {
+  timeval timeout{1, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  return connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+}
+
+
+TEST(TransportSocketTest, testAcceptWithoutDescriptors) {
+  const int PORT = 19103;
+  const int NUM_CLIENTS = 4;
+  Net::TransportSocket server(PORT);
+  server.setLocalOnly(true);
+  std::atomic<int> accepted(0);
+  server.onAccept([&](std::weak_ptr<Net::Connection>) { accepted++; });
+  std::atomic<bool> stop(false);
+  std::thread listener([&]() { server.listen([&]() -> bool { return stop; }); });
+
+  int probe = -1;
+  for (int attempt = 0; attempt < 100 && probe == -1; attempt++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    probe = socket(AF_INET, SOCK_STREAM, 0);
+    if (!connectLocal(probe, PORT)) {
+      ::close(probe);
+      probe = -1;
+    }
+  }
+  ASSERT_NE(-1, probe);
+  for (int attempt = 0; attempt < 100 && accepted < 1; attempt++)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  ASSERT_EQ(1, accepted.load());
+
+  int clients[NUM_CLIENTS];
+  for (int i = 0; i < NUM_CLIENTS; i++)
+    clients[i] = socket(AF_INET, SOCK_STREAM, 0);
+
+  // No descriptor is left for the listener: the pending connections are
+  // shed instead of stalling in the backlog
+  rlimit limit;
+  ASSERT_EQ(0, getrlimit(RLIMIT_NOFILE, &limit));
+  rlimit lowered = limit;
+  int next = ::open("/dev/null", O_RDONLY);
+  ::close(next);
+  lowered.rlim_cur = static_cast<rlim_t>(next);
+  ASSERT_EQ(0, setrlimit(RLIMIT_NOFILE, &lowered));
+  for (int i = 0; i < NUM_CLIENTS; i++)
+    EXPECT_TRUE(connectLocal(clients[i], PORT));
+  for (int i = 0; i < NUM_CLIENTS; i++) {
+    char byte;
+    ssize_t n = recv(clients[i], &byte, 1, 0);
+    EXPECT_TRUE(n == 0 || (n == -1 && errno == ECONNRESET));
+  }
+  ASSERT_EQ(0, setrlimit(RLIMIT_NOFILE, &limit));
+  EXPECT_EQ(1, accepted.load());
+
+  // The listener goes on accepting once descriptors are available again
+  int client = socket(AF_INET, SOCK_STREAM, 0);
+  EXPECT_TRUE(connectLocal(client, PORT));
+  for (int attempt = 0; attempt < 100 && accepted < 2; attempt++)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_EQ(2, accepted.load());
+
+  stop = true;
+  server.interrupt();
+  listener.join();
+  ::close(client);
+  for (int i = 0; i < NUM_CLIENTS; i++)
+    ::close(clients[i]);
+  ::close(probe);
+}
+
+}
@@ -0,0 +1,412 @@
+/*
+ * @file   LoadGen.cpp
+ * @author Armin Zare Zadeh, ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   Open-loop load generator of the elevator controller. It opens
+ *          many requester connections, which speak the MsgProtocol wire
+ *          format, and sends the hall calls of a Poisson passenger stream
+ *          of the chosen traffic profile, e.g.
+ *            LoadGen --connections 2000 --threads 4 --rate 500 --profile up-peak
+ *          The latencies are measured from the time at which a call was
+ *          due, not from the time it could be sent, so a stalled controller
+ *          is not hidden by the generator waiting for it (coordinated
+ *          omission). A panel serves one passenger at a time, since the
+ *          controller ties the car call of a node to the car of its last
+ *          hall call; passengers arriving while every panel is busy are
+ *          skipped and reported. Linux only (epoll); raise the open file
+ *          limit with ulimit -n for many connections.
+ */
+
+#include <NetProtocol.h>
+#include <LatencyHistogram.h>
+#include <TrafficProfile.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace Net;
+
+
+struct Options {
+  std::string host = "127.0.0.1";
+  int port = 8080;
+  size_t connections = 100;
+  size_t threads = 2;
+  double rate = 50.0;        // passengers per second over all threads
+  double duration = 10.0;    // seconds of sending
+  double drain = 30.0;       // seconds to wait for the outstanding answers
+  uint8_t floors = 16;
+  TrafficProfile::Kind profile = TrafficProfile::Kind::INTERFLOOR;
+  bool go = true;            // send the destination once the car has arrived
+  uint64_t seed = 1;
+};
+
+
+static int64_t now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+// Results of one worker thread
+struct Results {
+  LatencyHistogram ack;       // request sent (due) -> ACK received
+  LatencyHistogram arrival;   // hall call due -> car stopped at the origin
+  LatencyHistogram ride;      // car call due -> car stopped at the destination
+  uint64_t calls = 0;         // hall calls, one per passenger
+  uint64_t skipped = 0;       // passengers without an idle panel
+  uint64_t sent = 0;          // hall and car calls
+  uint64_t naks = 0;
+  uint64_t outstanding = 0;   // requests without an answer at the end
+  uint64_t lateNs = 0;        // worst delay of a send behind its due time
+};
+
+
+// Simulated panel on its own requester connection and node address. It
+// serves one passenger at a time, from the hall call to the arrival at the
+// destination.
+struct Panel {
+  // Request waiting for its ACK and its final status
+  struct Pending {
+    int64_t dueNs;
+    Request::Command cmd;
+    uint8_t destination;   // of the passenger of a hall call
+    bool acked;
+  };
+
+  int fd = -1;
+  uint16_t node = 0;
+  uint16_t nextMsgId = 0;
+  ByteRing rx{4096};
+  std::vector<uint8_t> tx;   // bytes the socket did not take yet
+  bool waitWritable = false;
+  std::unordered_map<uint16_t, Pending> pending;
+
+  bool idle() const { return pending.empty(); }
+};
+
+
+// Worker thread: owns a share of the connections and of the passenger rate
+class Worker {
+private:
+  const Options& options_;
+  int epoll_;
+  std::vector<std::unique_ptr<Panel>> connections_;
+  TrafficProfile profile_;
+  Results results_;
+  size_t nextConnection_ = 0;
+
+public:
+  Worker(const Options& options, size_t index, size_t firstNode, size_t numConnections) :
+      options_(options),
+      epoll_(epoll_create1(EPOLL_CLOEXEC)),
+      profile_(options.profile, options.floors, options.rate / options.threads, options.seed + index) {
+    if (epoll_ == -1)
+      throw std::runtime_error(std::string("epoll_create1: ") + strerror(errno));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(options.port));
+    if (inet_pton(AF_INET, options.host.c_str(), &address.sin_addr) != 1)
+      throw std::invalid_argument("Illegal host address: " + options.host);
+
+    for (size_t i = 0; i < numConnections; i++) {
+      std::unique_ptr<Panel> c(new Panel());
+      c->node = nodeAddress(firstNode + i);
+      c->fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+      if (c->fd == -1 || connect(c->fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == -1)
+        throw std::runtime_error(std::string("connect: ") + strerror(errno));
+      int one = 1;
+      setsockopt(c->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+      fcntl(c->fd, F_SETFL, fcntl(c->fd, F_GETFL) | O_NONBLOCK);
+
+      epoll_event event;
+      event.events = EPOLLIN;
+      event.data.ptr = c.get();
+      epoll_ctl(epoll_, EPOLL_CTL_ADD, c->fd, &event);
+      connections_.push_back(std::move(c));
+    }
+  }
+
+  ~Worker() {
+    for (auto& c : connections_) ::close(c->fd);
+    ::close(epoll_);
+  }
+
+  // Node address of the n-th connection; the controller's own address and
+  // the broadcast address are skipped
+  static uint16_t nodeAddress(size_t n) {
+    size_t node = n + 1;
+    if (node >= NODE_ADDRESS) node++;
+    if (node >= MsgProtocol::BROADCAST_ADDRESS)
+      throw std::invalid_argument("Too many connections");
+    return static_cast<uint16_t>(node);
+  }
+
+  const Results& results() const { return results_; }
+
+  // Sends the passenger stream until the end time, then waits for the
+  // outstanding answers until the drain time
+  void run(int64_t startNs, int64_t endNs, int64_t drainNs) {
+    int64_t dueNs = startNs + static_cast<int64_t>(profile_.nextGapNs());
+    epoll_event events[64];
+
+    while (true) {
+      int64_t now = now_ns();
+
+      // Open loop: every call which is due is sent now, however late
+      while (dueNs <= now && dueNs < endNs) {
+        results_.lateNs = std::max(results_.lateNs, static_cast<uint64_t>(now - dueNs));
+        TrafficProfile::Passenger p = profile_.next();
+        if (Panel* c = idlePanel()) {
+          results_.calls++;
+          send(*c, dueNs, Request::Command::CALL, p.origin, p.direction(), p.destination);
+        } else {
+          results_.skipped++;
+        }
+        dueNs += static_cast<int64_t>(profile_.nextGapNs());
+      }
+
+      if (now >= endNs && (now >= drainNs || outstanding() == 0))
+        break;
+
+      int64_t wakeNs = (dueNs < endNs) ? dueNs : drainNs;
+      int timeoutMs = static_cast<int>(std::max<int64_t>(0, (wakeNs - now + 999999) / 1000000));
+      int n = epoll_wait(epoll_, events, 64, std::min(timeoutMs, 100));
+      for (int i = 0; i < n; i++) {
+        Panel& c = *static_cast<Panel*>(events[i].data.ptr);
+        if (events[i].events & EPOLLOUT) flush(c);
+        if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) receive(c);
+      }
+    }
+    results_.outstanding = outstanding();
+  }
+
+private:
+  // Next panel without a passenger, round-robin; nullptr if all are busy
+  Panel* idlePanel() {
+    for (size_t i = 0; i < connections_.size(); i++) {
+      Panel* c = connections_[nextConnection_++ % connections_.size()].get();
+      if (c->idle())
+        return c;
+    }
+    return nullptr;
+  }
+
+  uint64_t outstanding() const {
+    uint64_t n = 0;
+    for (auto& c : connections_) n += c->pending.size();
+    return n;
+  }
+
+  void send(Panel& c, int64_t dueNs, Request::Command cmd, uint8_t floor, Request::Direction direction, uint8_t destination) {
+    MsgProtocol::msg_hdr_t header{MsgProtocol::MagicValue, c.node, NODE_ADDRESS,
+                                  static_cast<MsgProtocol::msg_class_t>(MsgProtocol::MSGTYPE::MSG_DATA),
+                                  c.nextMsgId++, static_cast<MsgProtocol::msg_len_t>(MsgProtocol::DATA_FRAME_LEN)};
+    MsgProtocol::msg_payload_t payload{static_cast<uint64_t>(dueNs), static_cast<uint8_t>(cmd), floor, static_cast<uint8_t>(direction)};
+    uint8_t frame[MsgProtocol::DATA_FRAME_LEN];
+    MsgProtocol::encode_data_frame(frame, header, payload);
+
+    c.pending[header.msg_id] = Panel::Pending{dueNs, cmd, destination, false};
+    c.tx.insert(c.tx.end(), frame, frame + sizeof(frame));
+    results_.sent++;
+    flush(c);
+  }
+
+  // Writes the buffered bytes; the rest waits for the socket to become
+  // writable again
+  void flush(Panel& c) {
+    size_t done = 0;
+    while (done < c.tx.size()) {
+      ssize_t n = ::send(c.fd, c.tx.data() + done, c.tx.size() - done, MSG_NOSIGNAL);
+      if (n <= 0) break;
+      done += static_cast<size_t>(n);
+    }
+    c.tx.erase(c.tx.begin(), c.tx.begin() + done);
+
+    bool waitWritable = !c.tx.empty();
+    if (waitWritable != c.waitWritable) {
+      epoll_event event;
+      event.events = EPOLLIN | (waitWritable ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+      event.data.ptr = &c;
+      epoll_ctl(epoll_, EPOLL_CTL_MOD, c.fd, &event);
+      c.waitWritable = waitWritable;
+    }
+  }
+
+  void receive(Panel& c) {
+    uint8_t frame[MsgProtocol::MAX_FRAME_LEN];
+    while (true) {
+      size_t len = 0;
+      uint8_t* buffer = c.rx.writePtr(len);
+      ssize_t n = (len == 0) ? 0 : recv(c.fd, buffer, len, MSG_DONTWAIT);
+      if (n > 0) c.rx.commit(static_cast<size_t>(n));
+
+      size_t frameLen;
+      while ((frameLen = MsgProtocol::extract_frame(c.rx, frame)) != 0)
+        handle(c, frame, frameLen);
+      if (n <= 0) break;
+    }
+  }
+
+  // An ACK/NAK answers a request; a STOPPED status report completes it
+  void handle(Panel& c, const uint8_t* frame, size_t len) {
+    int64_t now = now_ns();
+    MsgProtocol::msg_hdr_t header = MsgProtocol::decode_header(frame);
+    auto it = c.pending.find(header.msg_id);
+    if (it == c.pending.end())
+      return;
+    Panel::Pending& p = it->second;
+
+    uint8_t opType = header.msg_class & static_cast<uint8_t>(MsgProtocol::MSG_OPTYPE::OP_MASK);
+    if (opType == static_cast<uint8_t>(MsgProtocol::MSG_OPTYPE::OP_ACK)) {
+      results_.ack.record(static_cast<uint64_t>(now - p.dueNs));
+      p.acked = true;
+      return;
+    }
+    if (opType == static_cast<uint8_t>(MsgProtocol::MSG_OPTYPE::OP_NAK)) {
+      results_.naks++;
+      c.pending.erase(it);
+      return;
+    }
+
+    if (len != MsgProtocol::DATA_FRAME_LEN || !MsgProtocol::crc_check(frame, len))
+      return;
+    MsgProtocol::msg_payload_t payload = MsgProtocol::decode_payload(frame + MsgProtocol::HDR_LEN);
+    if (payload.command != MsgProtocol::STATUS_COMMAND || payload.direction != static_cast<uint8_t>(CarState::STOPPED))
+      return;
+
+    Panel::Pending done = p;
+    c.pending.erase(it);
+    if (done.cmd == Request::Command::CALL) {
+      results_.arrival.record(static_cast<uint64_t>(now - done.dueNs));
+      // The passenger boards and presses the destination button right away
+      if (options_.go)
+        send(c, now, Request::Command::GO, done.destination, Request::Direction::UP, 0);
+    } else {
+      results_.ride.record(static_cast<uint64_t>(now - done.dueNs));
+    }
+  }
+};
+
+
+static void report(const char* name, const LatencyHistogram& h, double unit, const char* unitName) {
+  std::cout << std::left << std::setw(8) << name << std::right << " n=" << std::setw(8) << h.count();
+  if (h.count() > 0) {
+    const double percents[] = {50, 90, 99, 99.9};
+    for (double percent : percents)
+      std::cout << "  p" << percent << "=" << std::setw(9) << static_cast<double>(h.percentile(percent)) / unit;
+    std::cout << "  max=" << static_cast<double>(h.max()) / unit;
+  }
+  std::cout << " " << unitName << std::endl;
+}
+
+
+static void usage(const char* program) {
+  std::cerr << "usage: " << program << " [--host ADDR] [--port N] [--connections N] [--threads N]\n"
+            << "         [--rate PASSENGERS_PER_S] [--duration S] [--drain S] [--floors N]\n"
+            << "         [--profile up-peak|down-peak|lunch|interfloor] [--no-go] [--seed N]" << std::endl;
+}
+
+
+int main(int argc, char* argv[]) {
+  Options options;
+  try {
+    for (int i = 1; i < argc; i++) {
+      std::string arg = argv[i];
+      if (arg == "--no-go") { options.go = false; continue; }
+      if (i + 1 >= argc) throw std::invalid_argument("Missing value of " + arg);
+      std::string value = argv[++i];
+      if (arg == "--host") options.host = value;
+      else if (arg == "--port") options.port = std::stoi(value);
+      else if (arg == "--connections") options.connections = std::stoul(value);
+      else if (arg == "--threads") options.threads = std::stoul(value);
+      else if (arg == "--rate") options.rate = std::stod(value);
+      else if (arg == "--duration") options.duration = std::stod(value);
+      else if (arg == "--drain") options.drain = std::stod(value);
+      else if (arg == "--floors") {
+        unsigned long floors = std::stoul(value);
+        if (floors < TrafficProfile::MIN_FLOORS || floors > std::numeric_limits<uint8_t>::max())
+          throw std::invalid_argument("Illegal number of floors: " + value);
+        options.floors = static_cast<uint8_t>(floors);
+      }
+      else if (arg == "--profile") options.profile = TrafficProfile::parse(value);
+      else if (arg == "--seed") options.seed = std::stoull(value);
+      else throw std::invalid_argument("Unknown option " + arg);
+    }
+    if (options.threads == 0 || options.connections < options.threads)
+      throw std::invalid_argument("Every thread needs a connection");
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    usage(argv[0]);
+    return 2;
+  }
+
+  // Frame dumps of the protocol helpers are not wanted here
+  Logger::instance().setLevel(LogLevel::WARN);
+
+  std::vector<std::unique_ptr<Worker>> workers;
+  try {
+    size_t first = 0;
+    for (size_t i = 0; i < options.threads; i++) {
+      size_t num = options.connections / options.threads + ((i < options.connections % options.threads) ? 1 : 0);
+      workers.emplace_back(new Worker(options, i, first, num));
+      first += num;
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
+  int64_t start = now_ns();
+  int64_t end = start + static_cast<int64_t>(options.duration * 1e9);
+  int64_t drain = end + static_cast<int64_t>(options.drain * 1e9);
+  std::vector<std::thread> threads;
+  for (auto& worker : workers) {
+    Worker* w = worker.get();
+    threads.push_back(std::thread([w, start, end, drain]() { w->run(start, end, drain); }));
+  }
+  for (auto& thread : threads) thread.join();
+  double elapsed = static_cast<double>(now_ns() - start) / 1e9;
+
+  Results total;
+  for (auto& worker : workers) {
+    const Results& r = worker->results();
+    total.ack.merge(r.ack);
+    total.arrival.merge(r.arrival);
+    total.ride.merge(r.ride);
+    total.calls += r.calls;
+    total.skipped += r.skipped;
+    total.sent += r.sent;
+    total.naks += r.naks;
+    total.outstanding += r.outstanding;
+    total.lateNs = std::max(total.lateNs, r.lateNs);
+  }
+
+  std::cout << "sent " << total.calls << " hall calls (" << static_cast<double>(total.calls) / options.duration
+            << " /s) and " << total.sent - total.calls << " car calls in " << elapsed << " s over "
+            << options.connections << " connections, " << total.skipped << " passengers skipped on busy panels, "
+            << total.naks << " NAKs, " << total.outstanding << " unanswered, worst send delay "
+            << static_cast<double>(total.lateNs) / 1e6 << " ms" << std::endl;
+  report("ack", total.ack, 1e3, "us");
+  report("arrival", total.arrival, 1e6, "ms");
+  report("ride", total.ride, 1e6, "ms");
+  return 0;
+}
@@ -0,0 +1,42 @@
+/*
+ * @file   TraceDecode.cpp
+ * @author Armin Zare Zadeh, ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   Decoder of the binary event trace of the controller. It
+ *          writes the trace as a Chrome / Perfetto timeline, e.g.
+ *            TraceDecode elevator.trace > elevator.json
+ *          and open elevator.json in ui.perfetto.dev or chrome://tracing.
+ *          With --text the events are listed one per line instead.
+ */
+
+#include <Trace.h>
+
+#include <cstring>
+#include <iostream>
+
+int main(int argc, char* argv[]) {
+  bool text = argc == 3 && strcmp(argv[1], "--text") == 0;
+  if (argc != 2 && !text) {
+    std::cerr << "usage: " << argv[0] << " [--text] <trace file>" << std::endl;
+    return 2;
+  }
+
+  try {
+    TraceReader reader(argv[argc - 1]);
+    if (!text) {
+      reader.writeChromeJson(std::cout);
+      return 0;
+    }
+    for (const auto& r : reader.records()) {
+      const TraceEvent& e = r.event;
+      std::cout << e.ns << " tid:" << r.tid << " " << TraceReader::name(e.type)
+                << " car:" << static_cast<int>(e.car) << " node:" << e.node << " msg:" << e.msgId
+                << " floor:" << static_cast<int>(e.floor) << " arg:" << static_cast<int>(e.arg) << "\n";
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
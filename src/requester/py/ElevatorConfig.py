@@ -29,8 +29,8 @@ class ElevatorConfig:
     # Network attributes
     self.network = {'type': '', 'addr': '', 'port': '', 'packet_header_len': '', 'packet_payload_req_len': '', 'packet_payload_status_len': ''}
 
-    # Request types: call, go
-    self.usr_request = {'call': '', 'go': '', 'status': ''}
+    # Request types: call, go, status, query
+    self.usr_request = {'call': '', 'go': '', 'status': '', 'query': ''}
     
     # Direction
     self.usr_dir = {'up': '', 'down': ''}
@@ -74,6 +74,7 @@ class ElevatorConfig:
       self.usr_request['call'] = data['__usr_request__']['__call__']
       self.usr_request['go'] = data['__usr_request__']['__go__']
       self.usr_request['status'] = data['__usr_request__']['__status__']
+      self.usr_request['query'] = data['__usr_request__']['__query__']
       
       self.usr_dir['up'] = data['__usr_dir__']['__up__']
       self.usr_dir['down'] = data['__usr_dir__']['__down__']
@@ -113,6 +114,7 @@ class ElevatorConfig:
     print("    call: {}".format(self.usr_request['call']))
     print("    go: {}".format(self.usr_request['go']))
     print("    status: {}".format(self.usr_request['status']))
+    print("    query: {}".format(self.usr_request['query']))
 
     print("  Available Directions:")
     print("    up: {}".format(self.usr_dir['up']))